@@ -0,0 +1,195 @@
+#include "scenario.hpp"
+#include "components.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+/*
+* Runs a physics scenario without a window or GL context and writes what it measured as JSON:
+*
+*	physics-bench <scenario file> [--bodies N] [--steps N] [--out file]
+*
+* --bodies and --steps override the scenario file. Without --out the JSON goes to stdout.
+* Peak memory is the process's, so run one scenario per process. stateHash identifies where the
+* bodies ended up, to check that builds with different instruction sets simulate the same.
+*/
+
+namespace {
+	/* The most memory the process has used so far, in bytes. */
+	size_t peakMemory() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters{};
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+			return 0;
+		}
+		return counters.PeakWorkingSetSize;
+#else
+		rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+		/* in kilobytes */
+		return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+	}
+
+	double milliseconds(std::chrono::steady_clock::duration duration) {
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+
+	/* FNV-1a over the bits of every body's position, in entity order. Builds that simulate the
+	   same steps bit for bit, e.g. the scalar, SSE2 and AVX2 ones, print the same hash. */
+	uint64_t stateHash(Coordinator& coordinator, const Systems::PhysicsSystem& physics) {
+		uint64_t hash = 14695981039346656037ull;
+		for (Entity entity : physics.m_entities) {
+			const glm::vec3 position = coordinator.getComponent<Components::Transform>(entity).Position;
+			uint32_t bits[3];
+			std::memcpy(bits, &position, sizeof(bits));
+			for (uint32_t word : bits) {
+				hash = (hash ^ word) * 1099511628211ull;
+			}
+		}
+		return hash;
+	}
+
+	void add(Systems::PhysicsTimings& total, const Systems::PhysicsTimings& step) {
+		total.Setup += step.Setup;
+		total.BroadPhase += step.BroadPhase;
+		total.NarrowPhase += step.NarrowPhase;
+		total.Solver += step.Solver;
+		total.Integration += step.Integration;
+		total.Continuous += step.Continuous;
+		total.Islands += step.Islands;
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "Usage: physics-bench <scenario file> [--bodies N] [--steps N] [--out file]\n";
+		return 1;
+	}
+
+	Bench::Scenario scenario;
+	if (!Bench::readScenario(argv[1], scenario)) {
+		return 1;
+	}
+	std::string out;
+	for (int i = 2; i + 1 < argc; i += 2) {
+		if (std::strcmp(argv[i], "--bodies") == 0) {
+			scenario.Bodies = static_cast<uint32_t>(std::stoul(argv[i + 1]));
+		} else if (std::strcmp(argv[i], "--steps") == 0) {
+			scenario.Steps = static_cast<uint32_t>(std::stoul(argv[i + 1]));
+		} else if (std::strcmp(argv[i], "--out") == 0) {
+			out = argv[i + 1];
+		} else {
+			std::cerr << "Error: Unknown option " << argv[i] << '\n';
+			return 1;
+		}
+	}
+	if (scenario.Bodies >= MAX_ENTITIES) {
+		std::cerr << "Error: " << scenario.Bodies << " bodies, this build holds at most " << MAX_ENTITIES - 1 << '\n';
+		return 1;
+	}
+
+	/* The coordinator logs every entity it creates or destroys, keep it out of the results */
+	std::cout.setstate(std::ios::failbit);
+
+	Coordinator coordinator;
+	coordinator.registerComponent<Components::RigidBody>();
+	coordinator.registerComponent<Components::Transform>();
+	std::shared_ptr<Systems::PhysicsSystem> physics = coordinator.registerSystem<Systems::PhysicsSystem>(coordinator);
+	{
+		Signature signature;
+		signature.set(coordinator.getComponentType<Components::RigidBody>());
+		signature.set(coordinator.getComponentType<Components::Transform>());
+		coordinator.setSystemSignature<Systems::PhysicsSystem>(signature);
+	}
+	physics->init();
+	const size_t memoryBeforeBodies = peakMemory();
+
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point buildStart = Clock::now();
+	Bench::buildScenario(scenario, coordinator, *physics);
+	const double buildTime = milliseconds(Clock::now() - buildStart);
+
+	for (uint32_t step = 0; step < scenario.Warmup; step++) {
+		physics->update(scenario.TimeStep);
+	}
+
+	std::vector<double> stepTimes;
+	stepTimes.reserve(scenario.Steps);
+	Systems::PhysicsTimings phases{};
+	const Clock::time_point runStart = Clock::now();
+	for (uint32_t step = 0; step < scenario.Steps; step++) {
+		const Clock::time_point stepStart = Clock::now();
+		physics->update(scenario.TimeStep);
+		stepTimes.push_back(milliseconds(Clock::now() - stepStart));
+		add(phases, physics->getTimings());
+	}
+	const double runTime = milliseconds(Clock::now() - runStart);
+	const size_t memoryPeak = peakMemory();
+
+	const uint64_t hash = stateHash(coordinator, *physics);
+	uint32_t sleeping = 0;
+	for (Entity entity : physics->m_entities) {
+		sleeping += coordinator.getComponent<Components::RigidBody>(entity).Sleeping;
+	}
+	std::cout.clear();
+
+	const double steps = std::max<double>(scenario.Steps, 1.0);
+	std::vector<double> sorted = stepTimes;
+	std::sort(sorted.begin(), sorted.end());
+	const auto percentile = [&sorted](double p) {
+		return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+	};
+
+	std::ofstream file;
+	if (!out.empty()) {
+		file.open(out);
+		if (!file.is_open()) {
+			std::cerr << "Error: Could not open " << out << '\n';
+			return 1;
+		}
+	}
+	std::ostream& json = out.empty() ? std::cout : file;
+	json << "{\n"
+		<< "\t\"scenario\": \"" << scenario.Name << "\",\n"
+		<< "\t\"bodies\": " << scenario.Bodies << ",\n"
+		<< "\t\"steps\": " << scenario.Steps << ",\n"
+		<< "\t\"warmup\": " << scenario.Warmup << ",\n"
+		<< "\t\"timeStep\": " << scenario.TimeStep << ",\n"
+		<< "\t\"buildMs\": " << buildTime << ",\n"
+		<< "\t\"runMs\": " << runTime << ",\n"
+		<< "\t\"stepsPerSecond\": " << (runTime > 0.0 ? scenario.Steps * 1000.0 / runTime : 0.0) << ",\n"
+		<< "\t\"stepMs\": { \"mean\": " << runTime / steps
+		<< ", \"median\": " << percentile(0.5)
+		<< ", \"p99\": " << percentile(0.99)
+		<< ", \"max\": " << (sorted.empty() ? 0.0 : sorted.back()) << " },\n"
+		<< "\t\"phaseMs\": { \"setup\": " << phases.Setup / steps
+		<< ", \"broadPhase\": " << phases.BroadPhase / steps
+		<< ", \"narrowPhase\": " << phases.NarrowPhase / steps
+		<< ", \"solver\": " << phases.Solver / steps
+		<< ", \"integration\": " << phases.Integration / steps
+		<< ", \"continuous\": " << phases.Continuous / steps
+		<< ", \"islands\": " << phases.Islands / steps << " },\n"
+		<< "\t\"bodiesLeft\": " << physics->m_entities.size() << ",\n"
+		<< "\t\"sleeping\": " << sleeping << ",\n"
+		<< "\t\"stateHash\": \"" << std::hex << hash << std::dec << "\",\n"
+		<< "\t\"memoryBeforeBodiesBytes\": " << memoryBeforeBodies << ",\n"
+		<< "\t\"peakMemoryBytes\": " << memoryPeak << "\n"
+		<< "}\n";
+	return 0;
+}
@@ -0,0 +1,223 @@
+#include "scenario.hpp"
+#include "components.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+using namespace Bench;
+
+namespace {
+	std::string trim(const std::string& text) {
+		const size_t first = text.find_first_not_of(" \t\r");
+		if (first == std::string::npos) {
+			return std::string();
+		}
+		return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+	}
+
+	bool parseLayout(const std::string& value, ScenarioLayout& layout) {
+		if (value == "fall") {
+			layout = ScenarioLayout::Fall;
+		} else if (value == "stacks") {
+			layout = ScenarioLayout::Stacks;
+		} else if (value == "pile") {
+			layout = ScenarioLayout::Pile;
+		} else if (value == "field") {
+			layout = ScenarioLayout::Field;
+		} else {
+			return false;
+		}
+		return true;
+	}
+
+	bool parseShape(const std::string& value, BodyShape& shape) {
+		if (value == "sphere") {
+			shape = BodyShape::Sphere;
+		} else if (value == "box") {
+			shape = BodyShape::Box;
+		} else if (value == "capsule") {
+			shape = BodyShape::Capsule;
+		} else if (value == "mixed") {
+			shape = BodyShape::Mixed;
+		} else {
+			return false;
+		}
+		return true;
+	}
+
+	// A collider one unit across, centered on the body.
+	Physics::ColliderShape collider(BodyShape shape, uint32_t index) {
+		if (shape == BodyShape::Mixed) {
+			shape = static_cast<BodyShape>(index % 3);
+		}
+		switch (shape) {
+		case BodyShape::Box:
+			return Physics::Box{ glm::vec3(-0.5f), glm::vec3(0.5f) };
+		case BodyShape::Capsule:
+			return Physics::Capsule{ 0.25f, 0.25f };
+		default:
+			return Physics::Sphere{ 0.5f };
+		}
+	}
+
+	float defaultSpacing(ScenarioLayout layout) {
+		switch (layout) {
+		case ScenarioLayout::Stacks:
+			return 3.0f;
+		case ScenarioLayout::Pile:
+			return 1.05f;
+		case ScenarioLayout::Field:
+			return 8.0f;
+		default:
+			return 1.5f;
+		}
+	}
+
+	// Bodies per row for count bodies in a square of rows, or a cube of rows and layers.
+	uint32_t squareSide(uint32_t count) {
+		return std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(count)))));
+	}
+
+	uint32_t cubeSide(uint32_t count) {
+		return std::max(1u, static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(count)))));
+	}
+}
+
+bool Bench::readScenario(const std::string& filename, Scenario& scenario) {
+	std::ifstream file(filename);
+	if (!file.is_open()) {
+		std::cerr << "Error: Could not open scenario file " << filename << std::endl;
+		return false;
+	}
+	scenario.Name = std::filesystem::path(filename).stem().string();
+
+	std::string line;
+	while (std::getline(file, line)) {
+		// Skip empty lines and comments
+		line = trim(line);
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		const size_t equalPos = line.find('=');
+		if (equalPos == std::string::npos) {
+			continue;
+		}
+		const std::string key = trim(line.substr(0, equalPos));
+		const std::string value = trim(line.substr(equalPos + 1));
+
+		try {
+			if (key == "NAME") {
+				scenario.Name = value;
+			} else if (key == "LAYOUT") {
+				if (!parseLayout(value, scenario.Layout)) {
+					std::cerr << "Error: Invalid value for LAYOUT: " << value << std::endl;
+				}
+			} else if (key == "SHAPE") {
+				if (!parseShape(value, scenario.Shape)) {
+					std::cerr << "Error: Invalid value for SHAPE: " << value << std::endl;
+				}
+			} else if (key == "BODIES") {
+				scenario.Bodies = static_cast<uint32_t>(std::stoul(value));
+			} else if (key == "STEPS") {
+				scenario.Steps = static_cast<uint32_t>(std::stoul(value));
+			} else if (key == "WARMUP") {
+				scenario.Warmup = static_cast<uint32_t>(std::stoul(value));
+			} else if (key == "TIMESTEP") {
+				scenario.TimeStep = std::stof(value);
+			} else if (key == "SEED") {
+				scenario.Seed = static_cast<uint32_t>(std::stoul(value));
+			} else if (key == "SPACING") {
+				scenario.Spacing = std::stof(value);
+			} else if (key == "STACK_HEIGHT") {
+				scenario.StackHeight = std::max(1u, static_cast<uint32_t>(std::stoul(value)));
+			} else if (key == "SLEEP") {
+				scenario.Sleep = std::stoi(value) != 0;
+			}
+		} catch (const std::exception&) {
+			std::cerr << "Error: Invalid value for " << key << ": " << value << std::endl;
+		}
+	}
+	return true;
+}
+
+void Bench::buildScenario(const Scenario& scenario, Coordinator& coordinator, Systems::PhysicsSystem& physics) {
+	const float spacing = scenario.Spacing > 0.0f ? scenario.Spacing : defaultSpacing(scenario.Layout);
+	std::mt19937 gen(scenario.Seed);
+	// Small offsets, so that bodies do not land exactly on top of each other
+	std::uniform_real_distribution<float> jitter(-0.1f, 0.1f);
+	std::uniform_real_distribution<float> slide(-2.0f, 2.0f);
+
+	Physics::SleepSettings sleep = physics.getSleepSettings();
+	sleep.Enabled = scenario.Sleep;
+	physics.setSleepSettings(sleep);
+
+	physics.addPlane(Physics::StaticPlane{ .Surface = Plane(0.0f, glm::vec3(0.0f, 1.0f, 0.0f)), .Bounds = BoundingBox() });
+
+	// Rows of side bodies, centered on the origin
+	uint32_t side = 1;
+	switch (scenario.Layout) {
+	case ScenarioLayout::Stacks:
+		side = squareSide((scenario.Bodies + scenario.StackHeight - 1) / scenario.StackHeight);
+		break;
+	case ScenarioLayout::Field:
+		side = squareSide(scenario.Bodies);
+		break;
+	default:
+		side = cubeSide(scenario.Bodies);
+		break;
+	}
+	const float origin = -0.5f * spacing * static_cast<float>(side - 1);
+
+	if (scenario.Layout == ScenarioLayout::Pile) {
+		// Walls facing in, a body's width around the block
+		const float wall = -origin + spacing;
+		for (const glm::vec3 normal : { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) }) {
+			physics.addPlane(Physics::StaticPlane{ .Surface = Plane(-wall, normal), .Bounds = BoundingBox() });
+		}
+	}
+
+	for (uint32_t i = 0; i < scenario.Bodies; i++) {
+		glm::vec3 position;
+		glm::vec3 velocity(0.0f);
+		switch (scenario.Layout) {
+		case ScenarioLayout::Stacks: {
+			const uint32_t stack = i / scenario.StackHeight;
+			position = glm::vec3(origin + spacing * (stack % side), 0.5f + (i % scenario.StackHeight), origin + spacing * (stack / side));
+			break;
+		}
+		case ScenarioLayout::Field:
+			position = glm::vec3(origin + spacing * (i % side), 0.5f, origin + spacing * (i / side));
+			velocity = glm::vec3(slide(gen), 0.0f, slide(gen));
+			break;
+		default: {
+			const uint32_t layer = i / (side * side);
+			const uint32_t cell = i % (side * side);
+			position = glm::vec3(origin + spacing * (cell % side) + jitter(gen), 2.0f + spacing * layer, origin + spacing * (cell / side) + jitter(gen));
+			break;
+		}
+		}
+
+		const Entity entity = coordinator.createEntity();
+		coordinator.addComponent(entity, Components::Transform{
+			.Position = position,
+			.Rotation = glm::vec3(0.0f),
+			.Scale = glm::vec3(1.0f),
+			.RotationAngle = 0.0f
+			});
+		coordinator.addComponent(entity, Components::RigidBody{
+			.Box = BoundingBox(glm::vec3(-0.5f), glm::vec3(0.5f)),
+			.Shape = Geometry::Geometry3D(),
+			.Anchored = false,
+			.onGround = false,
+			.Mass = 1.0f,
+			.Restitution = 0.1f,
+			.Velocity = velocity,
+			.Force = glm::vec3(0.0f),
+			.Collider = collider(scenario.Shape, i),
+			});
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "coordinator.hpp"
+#include "physics_system.hpp"
+
+namespace Bench {
+
+	// How the bodies of a scenario are placed.
+	enum class ScenarioLayout : uint8_t {
+		// A block of bodies dropped onto the ground, spread out.
+		Fall,
+		// Columns of bodies resting on the ground, StackHeight high.
+		Stacks,
+		// A block of bodies packed tightly, dropped into a walled pit.
+		Pile,
+		// Bodies far apart on the ground, sliding about and rarely meeting.
+		Field
+	};
+
+	enum class BodyShape : uint8_t {
+		Sphere,
+		Box,
+		Capsule,
+		// The three in turn.
+		Mixed
+	};
+
+	// A benchmark workload, read from a KEY=VALUE file like the engine's config. Every body is one
+	// unit across and the ground is a plane at y = 0, so the work only depends on the layout, the
+	// shape and the number of bodies.
+	struct Scenario {
+		std::string Name;
+		ScenarioLayout Layout = ScenarioLayout::Fall;
+		BodyShape Shape = BodyShape::Sphere;
+		uint32_t Bodies = 1000;
+		// Steps measured, after Warmup steps that are not.
+		uint32_t Steps = 600;
+		uint32_t Warmup = 0;
+		float TimeStep = 1.0f / 120.0f;
+		uint32_t Seed = 1;
+		// Distance between the centers of neighbouring bodies. 0 picks the layout's own.
+		float Spacing = 0.0f;
+		uint32_t StackHeight = 10;
+		bool Sleep = true;
+	};
+
+	// Reads a scenario file over the defaults. Name defaults to the file name without extension.
+	// Returns false if the file could not be opened.
+	bool readScenario(const std::string& filename, Scenario& scenario);
+
+	// Creates the scenario's bodies and planes.
+	void buildScenario(const Scenario& scenario, Coordinator& coordinator, Systems::PhysicsSystem& physics);
+}
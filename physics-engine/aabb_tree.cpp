@@ -0,0 +1,332 @@
+#include "aabb_tree.hpp"
+#include <algorithm>
+#include <cfloat>
+
+using namespace Physics;
+
+NodeIndex AABBTree::allocateNode() {
+	if (m_freeList == NULL_NODE) {
+		m_nodes.emplace_back();
+		m_worldBoxes.emplace_back();
+		return static_cast<NodeIndex>(m_nodes.size() - 1);
+	}
+	// Free nodes are linked through their parent index.
+	const NodeIndex node = m_freeList;
+	m_freeList = m_nodes[node].parent;
+	m_nodes[node] = TreeNode{};
+	return node;
+}
+
+void AABBTree::freeNode(NodeIndex node) {
+	m_nodes[node].parent = m_freeList;
+	m_nodes[node].height = -1;
+	m_freeList = node;
+}
+
+NodeIndex AABBTree::createProxy(const BoundingBox& box, Entity entity, CollisionLayer layer, CollisionLayer mask) {
+	const NodeIndex proxy = allocateNode();
+	TreeNode& node = m_nodes[proxy];
+	node.box = box.fatten(m_margin);
+	m_worldBoxes[proxy] = box;
+	node.entity = entity;
+	node.layers = layer;
+	node.masks = mask;
+	node.height = 0;
+	node.moved = true;
+	insertLeaf(proxy);
+	m_proxyCount++;
+	return proxy;
+}
+
+void AABBTree::destroyProxy(NodeIndex proxy) {
+	removeLeaf(proxy);
+	freeNode(proxy);
+	m_proxyCount--;
+}
+
+bool AABBTree::moveProxy(NodeIndex proxy, const BoundingBox& box) {
+	m_worldBoxes[proxy] = box;
+	if (m_nodes[proxy].box.contains(box)) {
+		return false;
+	}
+	removeLeaf(proxy);
+	m_nodes[proxy].box = box.fatten(m_margin);
+	m_nodes[proxy].moved = true;
+	insertLeaf(proxy);
+	return true;
+}
+
+void AABBTree::setProxyFilter(NodeIndex proxy, CollisionLayer layer, CollisionLayer mask) {
+	m_nodes[proxy].layers = layer;
+	m_nodes[proxy].masks = mask;
+	m_nodes[proxy].moved = true;
+	for (NodeIndex index = m_nodes[proxy].parent; index != NULL_NODE; index = m_nodes[index].parent) {
+		TreeNode& node = m_nodes[index];
+		node.layers = m_nodes[node.left].layers | m_nodes[node.right].layers;
+		node.masks = m_nodes[node.left].masks | m_nodes[node.right].masks;
+	}
+}
+
+// Recomputes the box, height and filter of a parent from its two children.
+void AABBTree::combine(NodeIndex parent, NodeIndex left, NodeIndex right) {
+	TreeNode& node = m_nodes[parent];
+	const TreeNode& a = m_nodes[left];
+	const TreeNode& b = m_nodes[right];
+	node.box = a.box.merge(b.box);
+	node.height = 1 + std::max(a.height, b.height);
+	node.layers = a.layers | b.layers;
+	node.masks = a.masks | b.masks;
+}
+
+void AABBTree::clear() {
+	m_nodes.clear();
+	m_worldBoxes.clear();
+	m_root = NULL_NODE;
+	m_freeList = NULL_NODE;
+	m_proxyCount = 0;
+}
+
+void AABBTree::insertLeaf(NodeIndex leaf) {
+	if (m_root == NULL_NODE) {
+		m_root = leaf;
+		m_nodes[leaf].parent = NULL_NODE;
+		return;
+	}
+
+	// Walk down the tree picking the child that grows the least (surface area heuristic).
+	const BoundingBox leafBox = m_nodes[leaf].box;
+	NodeIndex index = m_root;
+	while (!m_nodes[index].isLeaf()) {
+		const TreeNode& node = m_nodes[index];
+		const float area = node.box.surfaceArea();
+		const float combinedArea = node.box.merge(leafBox).surfaceArea();
+
+		// Cost of creating a new parent for this node and the new leaf.
+		const float cost = 2.0f * combinedArea;
+		// Minimum cost of pushing the leaf further down the tree.
+		const float inheritance = 2.0f * (combinedArea - area);
+
+		auto descendCost = [&](NodeIndex child) {
+			const TreeNode& c = m_nodes[child];
+			const float merged = c.box.merge(leafBox).surfaceArea();
+			return (c.isLeaf() ? merged : merged - c.box.surfaceArea()) + inheritance;
+		};
+		const float costLeft = descendCost(node.left);
+		const float costRight = descendCost(node.right);
+
+		if (cost < costLeft && cost < costRight) {
+			break;
+		}
+		index = costLeft < costRight ? node.left : node.right;
+	}
+
+	// Create a new parent holding the sibling and the leaf.
+	const NodeIndex sibling = index;
+	const NodeIndex oldParent = m_nodes[sibling].parent;
+	const NodeIndex newParent = allocateNode();
+	m_nodes[newParent].parent = oldParent;
+	m_nodes[newParent].left = sibling;
+	m_nodes[newParent].right = leaf;
+	combine(newParent, sibling, leaf);
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	if (oldParent != NULL_NODE) {
+		if (m_nodes[oldParent].left == sibling) {
+			m_nodes[oldParent].left = newParent;
+		} else {
+			m_nodes[oldParent].right = newParent;
+		}
+	} else {
+		m_root = newParent;
+	}
+
+	refit(m_nodes[leaf].parent);
+}
+
+void AABBTree::removeLeaf(NodeIndex leaf) {
+	if (leaf == m_root) {
+		m_root = NULL_NODE;
+		return;
+	}
+
+	const NodeIndex parent = m_nodes[leaf].parent;
+	const NodeIndex grandParent = m_nodes[parent].parent;
+	const NodeIndex sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+
+	if (grandParent != NULL_NODE) {
+		// Replace the parent with the sibling and fix up the ancestors.
+		if (m_nodes[grandParent].left == parent) {
+			m_nodes[grandParent].left = sibling;
+		} else {
+			m_nodes[grandParent].right = sibling;
+		}
+		m_nodes[sibling].parent = grandParent;
+		freeNode(parent);
+		refit(grandParent);
+	} else {
+		m_root = sibling;
+		m_nodes[sibling].parent = NULL_NODE;
+		freeNode(parent);
+	}
+}
+
+void AABBTree::refit(NodeIndex index) {
+	while (index != NULL_NODE) {
+		index = balance(index);
+		combine(index, m_nodes[index].left, m_nodes[index].right);
+		index = m_nodes[index].parent;
+	}
+}
+
+// Performs a left or right rotation if node A is imbalanced. Returns the new root of the subtree.
+NodeIndex AABBTree::balance(NodeIndex iA) {
+	TreeNode& A = m_nodes[iA];
+	if (A.isLeaf() || A.height < 2) {
+		return iA;
+	}
+
+	const NodeIndex iB = A.left;
+	const NodeIndex iC = A.right;
+	TreeNode& B = m_nodes[iB];
+	TreeNode& C = m_nodes[iC];
+
+	const int32_t difference = C.height - B.height;
+
+	// Rotate C up.
+	if (difference > 1) {
+		const NodeIndex iF = C.left;
+		const NodeIndex iG = C.right;
+		TreeNode& F = m_nodes[iF];
+		TreeNode& G = m_nodes[iG];
+
+		C.left = iA;
+		C.parent = A.parent;
+		A.parent = iC;
+
+		if (C.parent != NULL_NODE) {
+			if (m_nodes[C.parent].left == iA) {
+				m_nodes[C.parent].left = iC;
+			} else {
+				m_nodes[C.parent].right = iC;
+			}
+		} else {
+			m_root = iC;
+		}
+
+		if (F.height > G.height) {
+			C.right = iF;
+			A.right = iG;
+			G.parent = iA;
+			combine(iA, iB, iG);
+			combine(iC, iA, iF);
+		} else {
+			C.right = iG;
+			A.right = iF;
+			F.parent = iA;
+			combine(iA, iB, iF);
+			combine(iC, iA, iG);
+		}
+		return iC;
+	}
+
+	// Rotate B up.
+	if (difference < -1) {
+		const NodeIndex iD = B.left;
+		const NodeIndex iE = B.right;
+		TreeNode& D = m_nodes[iD];
+		TreeNode& E = m_nodes[iE];
+
+		B.left = iA;
+		B.parent = A.parent;
+		A.parent = iB;
+
+		if (B.parent != NULL_NODE) {
+			if (m_nodes[B.parent].left == iA) {
+				m_nodes[B.parent].left = iB;
+			} else {
+				m_nodes[B.parent].right = iB;
+			}
+		} else {
+			m_root = iB;
+		}
+
+		if (D.height > E.height) {
+			B.right = iD;
+			A.left = iE;
+			E.parent = iA;
+			combine(iA, iC, iE);
+			combine(iB, iA, iD);
+		} else {
+			B.right = iE;
+			A.left = iD;
+			D.parent = iA;
+			combine(iA, iC, iD);
+			combine(iB, iA, iE);
+		}
+		return iB;
+	}
+
+	return iA;
+}
+
+// Throws away the internal nodes and rebuilds the hierarchy top-down over the existing leaves.
+// Leaf indices (proxies) are preserved.
+void AABBTree::rebuild() {
+	if (m_root == NULL_NODE) {
+		return;
+	}
+
+	std::vector<NodeIndex> leaves;
+	leaves.reserve(m_proxyCount);
+	for (NodeIndex i = 0; i < static_cast<NodeIndex>(m_nodes.size()); i++) {
+		TreeNode& node = m_nodes[i];
+		if (node.height < 0) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			node.parent = NULL_NODE;
+			leaves.push_back(i);
+		} else {
+			freeNode(i);
+		}
+	}
+
+	m_root = build(leaves, 0, leaves.size());
+	m_nodes[m_root].parent = NULL_NODE;
+}
+
+NodeIndex AABBTree::build(std::vector<NodeIndex>& leaves, size_t begin, size_t end) {
+	if (end - begin == 1) {
+		return leaves[begin];
+	}
+
+	// Split at the median centroid along the longest axis of the centroid bounds.
+	glm::vec3 cmin = glm::vec3(FLT_MAX);
+	glm::vec3 cmax = glm::vec3(-FLT_MAX);
+	for (size_t i = begin; i < end; i++) {
+		const BoundingBox& box = m_nodes[leaves[i]].box;
+		const glm::vec3 c = (box.min + box.max) * 0.5f;
+		cmin = glm::min(cmin, c);
+		cmax = glm::max(cmax, c);
+	}
+	const glm::vec3 extent = cmax - cmin;
+	const int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+
+	const size_t mid = begin + (end - begin) / 2;
+	std::nth_element(leaves.begin() + begin, leaves.begin() + mid, leaves.begin() + end,
+		[this, axis](NodeIndex a, NodeIndex b) {
+			return (m_nodes[a].box.min[axis] + m_nodes[a].box.max[axis]) < (m_nodes[b].box.min[axis] + m_nodes[b].box.max[axis]);
+		});
+
+	const NodeIndex left = build(leaves, begin, mid);
+	const NodeIndex right = build(leaves, mid, end);
+
+	const NodeIndex parent = allocateNode();
+	m_nodes[parent].left = left;
+	m_nodes[parent].right = right;
+	combine(parent, left, right);
+	m_nodes[left].parent = parent;
+	m_nodes[right].parent = parent;
+	return parent;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "box.hpp"
+#include "types.hpp"
+#include "collision_filter.hpp"
+
+namespace Physics {
+
+	// Index of a node in the tree. Proxies handed out to callers are leaf node indices.
+	using NodeIndex = int32_t;
+
+	constexpr NodeIndex NULL_NODE = -1;
+
+	// Size of the traversal stack. Balanced trees never come close to this depth.
+	constexpr size_t TREE_STACK_SIZE = 256;
+
+	// A node of the bounding volume hierarchy. Leaves hold one entity, internal nodes hold the
+	// union of their children. Nodes live in a flat array and refer to each other by index.
+	// Layers and masks of internal nodes are the union of their subtree, so a query can skip a
+	// whole subtree that has nothing it can collide with before looking at its box.
+	struct TreeNode {
+		BoundingBox box{};
+		Entity entity{};
+		CollisionLayer layers{ Layers::All };
+		CollisionLayer masks{ Layers::All };
+		NodeIndex parent{ NULL_NODE };
+		NodeIndex left{ NULL_NODE };
+		NodeIndex right{ NULL_NODE };
+		// Leaf = 0, free node = -1.
+		int32_t height{ -1 };
+		// Set when a leaf is created or its fat box changes, cleared by the owner of the tree.
+		bool moved{};
+
+		bool isLeaf() const { return left == NULL_NODE; }
+	};
+
+	// A dynamic AABB tree (bounding volume hierarchy) used by the broad phase.
+	// Leaves store a "fat" box, the entity's world box grown by a margin, so that small movements
+	// do not require the tree to be restructured. The tree is kept balanced with rotations on insert,
+	// and can be rebuilt from scratch with a top-down median split, which gives a better tree
+	// for bodies that never move.
+	class AABBTree {
+	public:
+		AABBTree(float margin = 0.1f) : m_margin(margin) {}
+		~AABBTree() = default;
+
+		NodeIndex		createProxy(const BoundingBox& box, Entity entity, CollisionLayer layer = Layers::All, CollisionLayer mask = Layers::All);
+		void			destroyProxy(NodeIndex proxy);
+		// Returns true if the fat box had to be updated, i.e. the proxy has moved out of its old fat box.
+		bool			moveProxy(NodeIndex proxy, const BoundingBox& box);
+		void			setProxyFilter(NodeIndex proxy, CollisionLayer layer, CollisionLayer mask);
+		bool			wasMoved(NodeIndex proxy) const { return m_nodes[proxy].moved; }
+		void			clearMoved(NodeIndex proxy) { m_nodes[proxy].moved = false; }
+		void			rebuild();
+		void			clear();
+
+		const BoundingBox& getFatBox(NodeIndex proxy) const { return m_nodes[proxy].box; }
+		const BoundingBox& getWorldBox(NodeIndex proxy) const { return m_worldBoxes[proxy]; }
+		Entity			getEntity(NodeIndex proxy) const { return m_nodes[proxy].entity; }
+		size_t			getProxyCount() const { return m_proxyCount; }
+		NodeIndex		getRoot() const { return m_root; }
+		const TreeNode&	getNode(NodeIndex node) const { return m_nodes[node]; }
+		int32_t			getHeight() const { return m_root == NULL_NODE ? 0 : m_nodes[m_root].height; }
+
+		// Calls callback(proxy) for every leaf in the tree.
+		template<class Callback>
+		void forEachProxy(Callback&& callback) const {
+			for (NodeIndex i = 0; i < static_cast<NodeIndex>(m_nodes.size()); i++) {
+				if (m_nodes[i].height == 0) {
+					callback(i);
+				}
+			}
+		}
+
+		// Calls callback(proxy) for every leaf whose fat box overlaps the box, and whose layer and mask
+		// pass the filter. The callback returns false to stop the query early.
+		template<class Callback>
+		void query(const BoundingBox& box, Callback&& callback, CollisionLayer layer = Layers::All, CollisionLayer mask = Layers::All) const {
+			if (m_root == NULL_NODE) {
+				return;
+			}
+			NodeIndex stack[TREE_STACK_SIZE];
+			size_t top = 0;
+			stack[top++] = m_root;
+			while (top > 0) {
+				const NodeIndex index = stack[--top];
+				const TreeNode& node = m_nodes[index];
+				// Filter first, it is cheaper than the box test
+				if (!shouldCollide(layer, mask, node.layers, node.masks)) {
+					continue;
+				}
+				if (!node.box.overlaps(box)) {
+					continue;
+				}
+				if (node.isLeaf()) {
+					if (!callback(index)) {
+						return;
+					}
+				} else {
+					stack[top++] = node.left;
+					stack[top++] = node.right;
+				}
+			}
+		}
+	private:
+		NodeIndex		allocateNode();
+		void			freeNode(NodeIndex node);
+		void			insertLeaf(NodeIndex leaf);
+		void			removeLeaf(NodeIndex leaf);
+		NodeIndex		balance(NodeIndex node);
+		void			combine(NodeIndex parent, NodeIndex left, NodeIndex right);
+		void			refit(NodeIndex node);
+		NodeIndex		build(std::vector<NodeIndex>& leaves, size_t begin, size_t end);
+	private:
+		std::vector<TreeNode>	m_nodes{};
+		// The exact world box of each leaf, indexed like m_nodes. Used by scene queries.
+		std::vector<BoundingBox> m_worldBoxes{};
+		NodeIndex				m_root{ NULL_NODE };
+		NodeIndex				m_freeList{ NULL_NODE };
+		size_t					m_proxyCount{};
+		float					m_margin{};
+	};
+}
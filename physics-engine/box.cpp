@@ -13,6 +13,11 @@ bool BoundingBox::overlaps(const BoundingBox& other) const {
 		(max.z >= other.min.z && other.max.z >= min.z);
 }
 
+bool BoundingBox::contains(const BoundingBox& other) const {
+	return (min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z) &&
+		(other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z);
+}
+
 glm::vec3 BoundingBox::overlap(const BoundingBox& other) const {
 	return glm::vec3(
 		glm::max(0.0f, glm::min(min.x, other.min.x) - glm::max(max.x, other.max.x)),
@@ -21,6 +26,19 @@ glm::vec3 BoundingBox::overlap(const BoundingBox& other) const {
 	);
 }
 
+BoundingBox BoundingBox::merge(const BoundingBox& other) const {
+	return BoundingBox(glm::min(min, other.min), glm::max(max, other.max));
+}
+
+BoundingBox BoundingBox::fatten(float margin) const {
+	return BoundingBox(min - glm::vec3(margin), max + glm::vec3(margin));
+}
+
+float BoundingBox::surfaceArea() const {
+	const glm::vec3 d = max - min;
+	return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
 std::string BoundingBox::toString() {
 	return std::format("[BoundingBox] min: [{}, {}, {}] | max: [{}, {}, {}]", min.x, min.y, min.z, max.x, max.y, max.z);
 }
@@ -25,13 +25,18 @@ struct BoundingBox {
 	BoundingBox() = default;
 	BoundingBox(glm::vec3 min, glm::vec3 max) : min(min), max(max), center(0.0f), overlapping(false) {}
 	BoundingBox(glm::vec3 min, glm::vec3 max, glm::vec3 center) : min(min), max(max), center(center), overlapping(false) {}
-	BoundingBox(glm::vec3 min, glm::vec3 max, glm::vec3 center, glm::vec3 rotation) : min(min), max(max), center(center), overlapping(false) {}
+	BoundingBox(glm::vec3 min, glm::vec3 max, glm::vec3 center, glm::vec3 /*rotation*/) : min(min), max(max), center(center), overlapping(false) {}
 	constexpr BoundingBox(float lenX, float lenY, float lenZ) : min(glm::vec3(-lenX / 2.0f, -lenY / 2.0f, -lenZ / 2.0f)), max(glm::vec3(lenX / 2.0f, lenY / 2.0f, lenZ / 2.0f)), center(0.0f), overlapping(false) {}
 	constexpr BoundingBox(float minX, float minY, float minZ, float maxX, float maxY, float maxZ) : min(glm::vec3(minX, minY, minZ)), max(glm::vec3(maxX, maxY, maxZ)), center(0.0f), overlapping(false) {}
 	constexpr BoundingBox(const BoundingBox& other, glm::vec3 worldPos) : min(other.min + worldPos), max(other.max + worldPos), center(worldPos), overlapping(false) {}
+	BoundingBox(const BoundingBox& other) = default;
 	BoundingBox& operator=(const BoundingBox& other);
 
 	bool overlaps(const BoundingBox& other) const;
+	bool contains(const BoundingBox& other) const;
 	glm::vec3 overlap(const BoundingBox& other) const;
+	BoundingBox merge(const BoundingBox& other) const;
+	BoundingBox fatten(float margin) const;
+	float surfaceArea() const;
 	std::string toString();
 };
\ No newline at end of file
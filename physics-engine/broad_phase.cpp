@@ -0,0 +1,160 @@
+#include "broad_phase.hpp"
+#include <algorithm>
+
+using namespace Physics;
+
+void BroadPhase::insert(Entity entity, const BoundingBox& box, bool isStatic, CollisionLayer layer, CollisionLayer mask) {
+	m_proxies[entity] = Proxy{ treeOf(isStatic).createProxy(box, entity, layer, mask), isStatic };
+	m_moveBuffer.push_back(entity);
+	if (isStatic) {
+		m_staticDirty = true;
+	}
+}
+
+void BroadPhase::remove(Entity entity) {
+	auto it = m_proxies.find(entity);
+	if (it == m_proxies.end()) {
+		return;
+	}
+	treeOf(it->second.isStatic).destroyProxy(it->second.node);
+	if (it->second.isStatic) {
+		m_staticDirty = true;
+	}
+	m_proxies.erase(it);
+	m_removed.push_back(entity);
+}
+
+void BroadPhase::update(Entity entity, const BoundingBox& box) {
+	const Proxy& proxy = m_proxies.at(entity);
+	if (treeOf(proxy.isStatic).moveProxy(proxy.node, box)) {
+		m_moveBuffer.push_back(entity);
+		// Static bodies only move when teleported, rebuild the tree lazily when that happens.
+		if (proxy.isStatic) {
+			m_staticDirty = true;
+		}
+	}
+}
+
+void BroadPhase::setFilter(Entity entity, CollisionLayer layer, CollisionLayer mask) {
+	const Proxy& proxy = m_proxies.at(entity);
+	treeOf(proxy.isStatic).setProxyFilter(proxy.node, layer, mask);
+	m_moveBuffer.push_back(entity);
+}
+
+bool BroadPhase::hasFilter(Entity entity, CollisionLayer layer, CollisionLayer mask) const {
+	const Proxy& proxy = m_proxies.at(entity);
+	const TreeNode& node = treeOf(proxy.isStatic).getNode(proxy.node);
+	return node.layers == layer && node.masks == mask;
+}
+
+void BroadPhase::addPair(Entity a, NodeIndex proxyA, Entity b, NodeIndex proxyB, bool isStatic) {
+	if (!isStatic && b < a) {
+		std::swap(a, b);
+		std::swap(proxyA, proxyB);
+	}
+	auto [it, inserted] = m_pairs.try_emplace(makePairKey(a, b), CachedPair{ a, b, proxyA, proxyB, isStatic });
+	if (!inserted) {
+		return;
+	}
+	// Put the pair at the front of the lists of both bodies
+	CachedPair& pair = it->second;
+	for (const Entity entity : { a, b }) {
+		const int side = pair.side(entity);
+		pair.next[side] = m_bodyPairs[entity];
+		if (pair.next[side] != nullptr) {
+			pair.next[side]->prev[pair.next[side]->side(entity)] = &pair;
+		}
+		m_bodyPairs[entity] = &pair;
+	}
+	m_events.push_back(PairEvent{ PairEventType::Begin, a, b });
+}
+
+// Takes the pair out of the lists of its bodies and the cache, and records its end.
+void BroadPhase::removePair(CachedPair& pair) {
+	for (const Entity entity : { pair.a, pair.b }) {
+		const int side = pair.side(entity);
+		CachedPair* next = pair.next[side];
+		CachedPair* prev = pair.prev[side];
+		if (prev != nullptr) {
+			prev->next[prev->side(entity)] = next;
+		} else {
+			m_bodyPairs[entity] = next;
+		}
+		if (next != nullptr) {
+			next->prev[next->side(entity)] = prev;
+		}
+	}
+	m_events.push_back(PairEvent{ PairEventType::End, pair.a, pair.b, pair.contact });
+	m_pairs.erase(makePairKey(pair.a, pair.b));
+}
+
+void BroadPhase::updatePairs() {
+	m_events.clear();
+
+	if (m_staticDirty) {
+		m_staticTree.rebuild();
+		m_staticDirty = false;
+	}
+
+	// Drop the pairs of removed bodies, and the pairs of moved proxies that no longer overlap.
+	// Pairs between two proxies that did not move cannot have changed.
+	for (Entity entity : m_removed) {
+		while (m_bodyPairs[entity] != nullptr) {
+			removePair(*m_bodyPairs[entity]);
+		}
+	}
+	for (Entity entity : m_moveBuffer) {
+		for (CachedPair* pair = m_bodyPairs[entity]; pair != nullptr;) {
+			CachedPair* next = pair->next[pair->side(entity)];
+			const TreeNode& nodeA = m_dynamicTree.getNode(pair->proxyA);
+			const TreeNode& nodeB = treeOf(pair->isStatic).getNode(pair->proxyB);
+			if (!nodeA.box.overlaps(nodeB.box) || !shouldCollide(nodeA.layers, nodeA.masks, nodeB.layers, nodeB.masks)) {
+				removePair(*pair);
+			}
+			pair = next;
+		}
+	}
+
+	// Query the moved proxies for new pairs. A moved dynamic proxy is tested against both trees,
+	// a moved static proxy only against the dynamic tree.
+	for (Entity entity : m_moveBuffer) {
+		auto found = m_proxies.find(entity);
+		if (found == m_proxies.end()) {
+			continue;
+		}
+		const Proxy proxy = found->second;
+		const TreeNode& node = treeOf(proxy.isStatic).getNode(proxy.node);
+		if (node.layers == Layers::None || node.masks == Layers::None) {
+			continue;
+		}
+
+		if (proxy.isStatic) {
+			m_dynamicTree.query(node.box, [this, &proxy, entity](NodeIndex other) {
+				addPair(m_dynamicTree.getEntity(other), other, entity, proxy.node, true);
+				return true;
+			}, node.layers, node.masks);
+			continue;
+		}
+
+		m_dynamicTree.query(node.box, [this, &proxy, entity](NodeIndex other) {
+			if (other != proxy.node) {
+				addPair(entity, proxy.node, m_dynamicTree.getEntity(other), other, false);
+			}
+			return true;
+		}, node.layers, node.masks);
+
+		m_staticTree.query(node.box, [this, &proxy, entity](NodeIndex other) {
+			addPair(entity, proxy.node, m_staticTree.getEntity(other), other, true);
+			return true;
+		}, node.layers, node.masks);
+	}
+
+	for (Entity entity : m_moveBuffer) {
+		auto found = m_proxies.find(entity);
+		if (found != m_proxies.end()) {
+			treeOf(found->second.isStatic).clearMoved(found->second.node);
+		}
+	}
+	m_moveBuffer.clear();
+	m_removed.clear();
+}
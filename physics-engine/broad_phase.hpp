@@ -0,0 +1,103 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include "aabb_tree.hpp"
+#include "pair_cache.hpp"
+
+namespace Physics {
+
+	// The broad phase keeps anchored (static) and moving (dynamic) bodies in two separate trees.
+	// The static tree is only rebuilt when static bodies are added, removed or moved (the physics
+	// system moves them in PhysicsSystem::teleport), and is never queried against itself, so
+	// static-static pairs are never considered.
+	// Collision layers and masks are tested during tree traversal, before any box is looked at.
+	//
+	// Overlapping pairs are kept in a persistent cache. Each step only the proxies whose fat box
+	// changed (the move buffer) are queried for new pairs, and only pairs touching a moved proxy are
+	// checked for separation: the pairs of each body are linked into a list of their own, so bodies
+	// that stay where they are cost nothing. Pair begin/end events are recorded for the step.
+	class BroadPhase {
+	public:
+		BroadPhase() :
+			m_staticTree(0.0f),
+			m_dynamicTree(0.1f),
+			m_proxies(),
+			m_pairs(),
+			m_bodyPairs(MAX_ENTITIES, nullptr),
+			m_events(),
+			m_moveBuffer(),
+			m_removed(),
+			m_staticDirty(false) { }
+		~BroadPhase() = default;
+	public:
+		void		insert(Entity entity, const BoundingBox& box, bool isStatic, CollisionLayer layer = Layers::All, CollisionLayer mask = Layers::All);
+		void		remove(Entity entity);
+		void		update(Entity entity, const BoundingBox& box);
+		void		setFilter(Entity entity, CollisionLayer layer, CollisionLayer mask);
+		bool		hasFilter(Entity entity, CollisionLayer layer, CollisionLayer mask) const;
+		bool		contains(Entity entity) const { return m_proxies.contains(entity); }
+		bool		isStatic(Entity entity) const { return m_proxies.at(entity).isStatic; }
+		void		updatePairs();
+
+		const PairCache& getPairs() const { return m_pairs; }
+		const std::vector<PairEvent>& getPairEvents() const { return m_events; }
+		const AABBTree& getStaticTree() const { return m_staticTree; }
+		const AABBTree& getDynamicTree() const { return m_dynamicTree; }
+
+		// Calls callback(entity) for every other body whose fat box overlaps box swept along motion,
+		// and that passes the filter of entity. Moving bodies are found where they were at the
+		// last update.
+		template<class Callback>
+		void querySwept(Entity entity, const BoundingBox& box, glm::vec3 motion, Callback&& callback) const {
+			const Proxy& proxy = m_proxies.at(entity);
+			const TreeNode& node = treeOf(proxy.isStatic).getNode(proxy.node);
+			const BoundingBox swept = box.merge(BoundingBox(box.min + motion, box.max + motion));
+			for (const bool isStatic : { true, false }) {
+				const AABBTree& tree = treeOf(isStatic);
+				tree.query(swept, [&](NodeIndex other) {
+					if (isStatic != proxy.isStatic || other != proxy.node) {
+						callback(tree.getEntity(other));
+					}
+					return true;
+				}, node.layers, node.masks);
+			}
+		}
+
+		// Calls callback(pair) for every cached pair of entity. The callback must not add or remove pairs.
+		template<class Callback>
+		void forEachPair(Entity entity, Callback&& callback) {
+			for (CachedPair* pair = m_bodyPairs[entity]; pair != nullptr; pair = pair->next[pair->side(entity)]) {
+				callback(*pair);
+			}
+		}
+
+		template<class Callback>
+		void forEachEntity(Callback&& callback) const {
+			for (const auto& [entity, proxy] : m_proxies) {
+				callback(entity);
+			}
+		}
+	private:
+		const AABBTree& treeOf(bool isStatic) const { return isStatic ? m_staticTree : m_dynamicTree; }
+		AABBTree&	treeOf(bool isStatic) { return isStatic ? m_staticTree : m_dynamicTree; }
+		void		addPair(Entity a, NodeIndex proxyA, Entity b, NodeIndex proxyB, bool isStatic);
+		void		removePair(CachedPair& pair);
+	private:
+		struct Proxy {
+			NodeIndex node;
+			bool isStatic;
+		};
+		AABBTree	m_staticTree;
+		AABBTree	m_dynamicTree;
+		std::unordered_map<Entity, Proxy> m_proxies;
+		PairCache	m_pairs;
+		// First pair of each entity's list, the pairs of the cache do not move.
+		std::vector<CachedPair*> m_bodyPairs;
+		std::vector<PairEvent> m_events;
+		// Proxies whose fat box changed since the last update.
+		std::vector<Entity> m_moveBuffer;
+		// Bodies removed since the last update, their pairs end.
+		std::vector<Entity> m_removed;
+		bool		m_staticDirty;
+	};
+}
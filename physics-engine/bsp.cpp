@@ -0,0 +1,340 @@
+#include "bsp.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace Physics;
+
+namespace {
+	struct Polygon {
+		std::vector<glm::vec3> points;
+		glm::vec3 normal;
+		float distance;
+	};
+
+	enum class Side { Front, Back, On, Spanning };
+
+	Side classify(const Polygon& polygon, glm::vec3 normal, float distance) {
+		bool front = false;
+		bool back = false;
+		for (const glm::vec3& point : polygon.points) {
+			const float d = glm::dot(normal, point) - distance;
+			front |= d > BSP_PLANE_EPSILON;
+			back |= d < -BSP_PLANE_EPSILON;
+		}
+		return front && back ? Side::Spanning : front ? Side::Front : back ? Side::Back : Side::On;
+	}
+
+	// Cuts a spanning polygon in two. Points on the plane go to both halves.
+	void split(const Polygon& polygon, glm::vec3 normal, float distance, Polygon& front, Polygon& back) {
+		front = Polygon{ {}, polygon.normal, polygon.distance };
+		back = Polygon{ {}, polygon.normal, polygon.distance };
+		const size_t count = polygon.points.size();
+		for (size_t i = 0; i < count; i++) {
+			const glm::vec3 a = polygon.points[i];
+			const glm::vec3 b = polygon.points[(i + 1) % count];
+			const float da = glm::dot(normal, a) - distance;
+			const float db = glm::dot(normal, b) - distance;
+			if (da >= -BSP_PLANE_EPSILON) {
+				front.points.push_back(a);
+			}
+			if (da <= BSP_PLANE_EPSILON) {
+				back.points.push_back(a);
+			}
+			if ((da > BSP_PLANE_EPSILON && db < -BSP_PLANE_EPSILON) || (da < -BSP_PLANE_EPSILON && db > BSP_PLANE_EPSILON)) {
+				const glm::vec3 crossing = a + (b - a) * (da / (da - db));
+				front.points.push_back(crossing);
+				back.points.push_back(crossing);
+			}
+		}
+	}
+
+	// The polygon whose plane splits the fewest others and leaves the two sides most even.
+	size_t chooseSplitter(const std::vector<Polygon>& polygons) {
+		const size_t step = std::max<size_t>(1, polygons.size() / BSP_SPLITTER_CANDIDATES);
+		size_t best = 0;
+		int bestScore = INT32_MAX;
+		for (size_t candidate = 0; candidate < polygons.size(); candidate += step) {
+			const Polygon& splitter = polygons[candidate];
+			int front = 0;
+			int back = 0;
+			int spanning = 0;
+			for (const Polygon& polygon : polygons) {
+				switch (classify(polygon, splitter.normal, splitter.distance)) {
+				case Side::Front: front++; break;
+				case Side::Back: back++; break;
+				case Side::Spanning: spanning++; break;
+				case Side::On: break;
+				}
+			}
+			const int score = spanning * BSP_SPLIT_COST + std::abs(front - back);
+			if (score < bestScore) {
+				best = candidate;
+				bestScore = score;
+			}
+		}
+		return best;
+	}
+
+	uint64_t hashGeometry(Geometry::Geometry3D& geometry) {
+		uint64_t hash = 14695981039346656037ull;
+		auto add = [&hash](const void* data, size_t size) {
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < size; i++) {
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+			}
+		};
+		add(&BSP_FORMAT_VERSION, sizeof(BSP_FORMAT_VERSION));
+		for (const Geometry::vertex& vertex : geometry.getVertices()) {
+			add(&vertex.position, sizeof(vertex.position));
+		}
+		for (const Geometry::face& face : geometry.getFaces()) {
+			add(&face.indices, sizeof(face.indices));
+		}
+		return hash;
+	}
+
+	// Faces of the geometry, or every three vertices if it has no faces.
+	std::vector<Polygon> triangles(Geometry::Geometry3D& geometry) {
+		std::vector<Polygon> polygons;
+		auto add = [&](glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+			const glm::vec3 normal = glm::cross(b - a, c - a);
+			const float length = glm::length(normal);
+			if (length > 1e-12f) {
+				polygons.push_back(Polygon{ { a, b, c }, normal / length, glm::dot(normal / length, a) });
+			}
+		};
+		auto& vertices = geometry.getVertices();
+		if (geometry.getFaces().empty()) {
+			for (size_t i = 0; i + 2 < vertices.size(); i += 3) {
+				add(vertices[i].position, vertices[i + 1].position, vertices[i + 2].position);
+			}
+		} else {
+			for (const Geometry::face& face : geometry.getFaces()) {
+				add(vertices[face.indices[0]].position, vertices[face.indices[1]].position, vertices[face.indices[2]].position);
+			}
+		}
+		return polygons;
+	}
+
+	struct FileHeader {
+		char magic[4];
+		uint32_t version;
+		uint64_t source;
+		uint32_t nodes;
+		uint32_t padding;
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+	constexpr char BSP_FILE_MAGIC[4] = { 'B', 'S', 'P', 'T' };
+}
+
+BSPTree Physics::compileBSP(Geometry::Geometry3D& geometry) {
+	BSPTree tree{};
+	tree.Source = hashGeometry(geometry);
+	std::vector<Polygon> polygons = triangles(geometry);
+	if (polygons.empty()) {
+		return tree;
+	}
+	tree.Bounds = BoundingBox(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+	for (const Polygon& polygon : polygons) {
+		for (const glm::vec3& point : polygon.points) {
+			tree.Bounds.min = glm::min(tree.Bounds.min, point);
+			tree.Bounds.max = glm::max(tree.Bounds.max, point);
+		}
+	}
+
+	// Sides left to build, each with the node it hangs from. Built from a work list rather than
+	// by recursion, badly shaped meshes can make deep trees.
+	struct Task {
+		std::vector<Polygon> polygons;
+		int32_t parent;
+		bool front;
+		size_t depth;
+	};
+	std::vector<Task> tasks;
+	tasks.push_back(Task{ std::move(polygons), -1, false, 0 });
+	while (!tasks.empty()) {
+		Task task = std::move(tasks.back());
+		tasks.pop_back();
+
+		int32_t index = BSP_EMPTY;
+		if (task.depth + 1 < BSP_STACK_SIZE) {
+			const Polygon& splitter = task.polygons[chooseSplitter(task.polygons)];
+			const glm::vec3 normal = splitter.normal;
+			const float distance = splitter.distance;
+			index = static_cast<int32_t>(tree.Nodes.size());
+			// Without polygons left in front the cell is empty, without any behind it is solid.
+			tree.Nodes.push_back(BSPNode{ normal, distance, BSP_EMPTY, BSP_SOLID });
+
+			std::vector<Polygon> front;
+			std::vector<Polygon> back;
+			for (const Polygon& polygon : task.polygons) {
+				switch (classify(polygon, normal, distance)) {
+				case Side::Front:
+					front.push_back(polygon);
+					break;
+				case Side::Back:
+					back.push_back(polygon);
+					break;
+				case Side::Spanning: {
+					Polygon frontPart, backPart;
+					split(polygon, normal, distance, frontPart, backPart);
+					front.push_back(std::move(frontPart));
+					back.push_back(std::move(backPart));
+					break;
+				}
+				case Side::On:
+					// Done with, the node's plane stands for it.
+					break;
+				}
+			}
+			if (!front.empty()) {
+				tasks.push_back(Task{ std::move(front), index, true, task.depth + 1 });
+			}
+			if (!back.empty()) {
+				tasks.push_back(Task{ std::move(back), index, false, task.depth + 1 });
+			}
+		}
+		if (task.parent >= 0) {
+			BSPNode& parent = tree.Nodes[task.parent];
+			(task.front ? parent.Front : parent.Back) = index;
+		}
+	}
+	return tree;
+}
+
+bool BSPTree::isSolid(glm::vec3 point) const {
+	int32_t node = root();
+	while (node >= 0) {
+		const BSPNode& n = Nodes[node];
+		node = glm::dot(n.Normal, point) >= n.Distance ? n.Front : n.Back;
+	}
+	return node == BSP_SOLID;
+}
+
+// Walks the cells along the ray front to back. At a plane the ray crosses, the part beyond it is
+// put on the stack and the near part is walked first, so the first solid cell reached is the hit.
+bool BSPTree::raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, float& t, glm::vec3& normal) const {
+	struct Entry {
+		int32_t node;
+		float tmin;
+		float tmax;
+		glm::vec3 normal;
+	};
+	Entry stack[BSP_STACK_SIZE];
+	size_t top = 0;
+	Entry entry{ root(), 0.0f, maxDistance, -direction };
+	while (true) {
+		while (entry.node >= 0) {
+			const BSPNode& node = Nodes[entry.node];
+			const float distance = glm::dot(node.Normal, origin) - node.Distance;
+			const float denominator = glm::dot(node.Normal, direction);
+			const bool inFront = distance >= 0.0f;
+			int32_t nearChild = inFront ? node.Front : node.Back;
+			const int32_t farChild = inFront ? node.Back : node.Front;
+			if (denominator != 0.0f) {
+				const float crossing = -distance / denominator;
+				if (crossing >= 0.0f && crossing <= entry.tmax) {
+					if (crossing >= entry.tmin) {
+						// A full stack, only possible with a tree deeper than loadBSP allows, drops
+						// the part beyond
+						if (top < BSP_STACK_SIZE) {
+							stack[top++] = Entry{ farChild, crossing, entry.tmax, inFront ? node.Normal : -node.Normal };
+						}
+						entry.tmax = crossing;
+					} else {
+						nearChild = farChild;
+					}
+				}
+			}
+			entry.node = nearChild;
+		}
+		if (entry.node == BSP_SOLID) {
+			t = entry.tmin;
+			normal = entry.normal;
+			return true;
+		}
+		if (top == 0) {
+			return false;
+		}
+		entry = stack[--top];
+	}
+}
+
+bool Physics::saveBSP(const BSPTree& tree, const std::string& path) {
+	std::error_code error;
+	const std::filesystem::path parent = std::filesystem::path(path).parent_path();
+	if (!parent.empty()) {
+		std::filesystem::create_directories(parent, error);
+	}
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		return false;
+	}
+	FileHeader header{};
+	std::memcpy(header.magic, BSP_FILE_MAGIC, sizeof(header.magic));
+	header.version = BSP_FORMAT_VERSION;
+	header.source = tree.Source;
+	header.nodes = static_cast<uint32_t>(tree.Nodes.size());
+	header.min = tree.Bounds.min;
+	header.max = tree.Bounds.max;
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(tree.Nodes.data()), tree.Nodes.size() * sizeof(BSPNode));
+	return file.good();
+}
+
+bool Physics::loadBSP(const std::string& path, BSPTree& tree) {
+	std::ifstream file(path, std::ios::binary);
+	FileHeader header{};
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+		|| std::memcmp(header.magic, BSP_FILE_MAGIC, sizeof(header.magic)) != 0
+		|| header.version != BSP_FORMAT_VERSION) {
+		return false;
+	}
+	// The node count must match what is left of the file before anything is allocated for it.
+	const std::streamoff start = file.tellg();
+	file.seekg(0, std::ios::end);
+	const std::streamoff remaining = file.tellg() - start;
+	if (start < 0 || remaining < 0 || static_cast<uint64_t>(remaining) != static_cast<uint64_t>(header.nodes) * sizeof(BSPNode)) {
+		return false;
+	}
+	file.seekg(start);
+	std::vector<BSPNode> nodes(header.nodes);
+	if (!file.read(reinterpret_cast<char*>(nodes.data()), nodes.size() * sizeof(BSPNode))) {
+		return false;
+	}
+	// Children always come after their parent, which also rules out cycles, and no node is deeper
+	// than the compiler lets one be, or the traversal stacks would overflow.
+	std::vector<size_t> depths(nodes.size(), 0);
+	for (size_t i = 0; i < nodes.size(); i++) {
+		if (depths[i] + 1 >= BSP_STACK_SIZE) {
+			return false;
+		}
+		for (const int32_t child : { nodes[i].Front, nodes[i].Back }) {
+			if (child == BSP_EMPTY || child == BSP_SOLID) {
+				continue;
+			}
+			if (child <= static_cast<int32_t>(i) || child >= static_cast<int32_t>(nodes.size())) {
+				return false;
+			}
+			depths[child] = std::max(depths[child], depths[i] + 1);
+		}
+	}
+	tree.Nodes = std::move(nodes);
+	tree.Bounds = BoundingBox(header.min, header.max);
+	tree.Source = header.source;
+	return true;
+}
+
+BSPTree Physics::loadOrCompileBSP(Geometry::Geometry3D& geometry, const std::string& cachePath) {
+	BSPTree tree{};
+	if (loadBSP(cachePath, tree) && tree.Source == hashGeometry(geometry)) {
+		return tree;
+	}
+	tree = compileBSP(geometry);
+	saveBSP(tree, cachePath);
+	return tree;
+}
@@ -1,8 +1,14 @@
 #pragma once
 
-#include "texture.hpp"
+#include "types.hpp"
+#include "box.hpp"
+#include "geometry.hpp"
 
 #include <glm/glm.hpp>
+#include <cfloat>
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 struct LevelVertex {
@@ -24,9 +30,118 @@ struct LevelGeometry {
 	std::vector<LevelVertex> vertices;
 };
 
-struct BSPnode {
-	BSPnode* front;
-	BSPnode* back;
-	int plane; // Which hyperplane was used for partitioning
-	LevelGeometry geometry; // level geometry struct
-};
\ No newline at end of file
+namespace Physics {
+
+	// Leaves of a BSP tree, stored in place of a child node index.
+	constexpr int32_t BSP_EMPTY = -1;
+	constexpr int32_t BSP_SOLID = -2;
+
+	// Size of the traversal stack, and the deepest the compiler lets a tree grow. Branches that
+	// would go deeper end in an empty leaf; the splitter choice keeps real levels far from this.
+	constexpr size_t BSP_STACK_SIZE = 256;
+
+	// Points closer than this to a plane are on it.
+	constexpr float BSP_PLANE_EPSILON = 1e-4f;
+	// Splitters tried per node, spread evenly over its polygons, and what splitting a polygon
+	// costs against an unbalanced split.
+	constexpr size_t BSP_SPLITTER_CANDIDATES = 32;
+	constexpr int BSP_SPLIT_COST = 8;
+
+	// Bumped whenever the compiler or the file layout changes, so stale cache files get rebuilt.
+	constexpr uint32_t BSP_FORMAT_VERSION = 1;
+
+	// A node of a solid-leaf BSP tree. Points with dot(Normal, p) >= Distance are in front. Front
+	// and Back are node indices, or BSP_EMPTY / BSP_SOLID for leaves.
+	struct BSPNode {
+		glm::vec3 Normal;
+		float Distance;
+		int32_t Front;
+		int32_t Back;
+	};
+
+	// Static level geometry compiled into a BSP tree, see compileBSP. Every leaf is a convex cell
+	// that is either all empty or all solid, so point, ray and shape queries walk one path from
+	// the root instead of testing triangles. Nodes live in a flat array, the root is node 0.
+	struct BSPTree {
+		std::vector<BSPNode> Nodes;
+		BoundingBox Bounds;
+		// Hash of the geometry the tree was compiled from, to tell whether a cached file is stale.
+		uint64_t Source = 0;
+
+		int32_t root() const { return Nodes.empty() ? BSP_EMPTY : 0; }
+
+		// Whether the point is inside the level's solid.
+		bool isSolid(glm::vec3 point) const;
+
+		// Nearest point where a ray enters the solid, and the face normal there. A ray starting in
+		// the solid hits at 0 with normal -direction. direction must be normalized.
+		bool raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, float& t, glm::vec3& normal) const;
+
+		// Finds how far a convex shape (anything with a support function, in the tree's space) is
+		// inside the solid. Each solid cell the shape reaches is left through the face of the cell
+		// the shape is least far behind; depth and normal are those of the cell that needs the
+		// largest push, normal pointing out of the solid. A shape is taken to reach a cell when it
+		// reaches behind every face of it, which is slightly conservative at the cell's corners.
+		template<class Shape>
+		bool penetration(const Shape& shape, float& depth, glm::vec3& normal) const {
+			struct Entry {
+				int32_t node;
+				float depth;
+				glm::vec3 normal;
+			};
+			if (Nodes.empty()) {
+				return false;
+			}
+			Entry stack[BSP_STACK_SIZE];
+			size_t top = 0;
+			stack[top++] = Entry{ root(), FLT_MAX, glm::vec3(0.0f) };
+			bool hit = false;
+			while (top > 0) {
+				const Entry entry = stack[--top];
+				if (entry.node == BSP_SOLID) {
+					if (!hit || entry.depth > depth) {
+						depth = entry.depth;
+						normal = entry.normal;
+						hit = true;
+					}
+					continue;
+				}
+				if (entry.node == BSP_EMPTY) {
+					continue;
+				}
+				const BSPNode& node = Nodes[entry.node];
+				const float front = glm::dot(node.Normal, shape.support(node.Normal)) - node.Distance;
+				const float back = node.Distance - glm::dot(node.Normal, shape.support(-node.Normal));
+				// A full stack is only possible with a tree deeper than loadBSP allows.
+				if (front > 0.0f && top < BSP_STACK_SIZE) {
+					stack[top++] = Entry{ node.Front, entry.depth, entry.normal };
+				}
+				if (back > 0.0f && top < BSP_STACK_SIZE) {
+					// The cells behind the node's face can be left back through it.
+					stack[top++] = back < entry.depth ? Entry{ node.Back, back, node.Normal } : Entry{ node.Back, entry.depth, entry.normal };
+				}
+			}
+			return hit;
+		}
+	};
+
+	// The collider of a static level body. Levels must be anchored, and are collided with through
+	// BSPTree::penetration instead of GJK.
+	struct Level {
+		std::shared_ptr<const BSPTree> Tree;
+	};
+
+	// Compiles a closed triangle mesh, faces wound counter-clockwise seen from outside, into a
+	// BSP tree. Each triangle's plane splits the space once; what is behind the last face on a
+	// side is solid, what is in front of it is empty.
+	BSPTree compileBSP(Geometry::Geometry3D& geometry);
+
+	// Tree files hold the nodes as they are in memory, for loading on the machine that wrote
+	// them. load returns false for missing, damaged or outdated files.
+	bool saveBSP(const BSPTree& tree, const std::string& path);
+	bool loadBSP(const std::string& path, BSPTree& tree);
+
+	// Loads the tree of the geometry from the cache file, or compiles it and writes the file
+	// when it is missing or was compiled from other geometry.
+	BSPTree loadOrCompileBSP(Geometry::Geometry3D& geometry, const std::string& cachePath);
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "ccd.hpp"
+#include "gjk.hpp"
+#include "epa.hpp"
+
+using namespace Physics;
+
+namespace {
+	// Bisects the time of impact between the last time known clear (0) and the first known to hit
+	// (1), hits(time) telling whether the shape swept that far overlaps.
+	template<class Hits>
+	void bisect(Hits&& hits, float length, float& clear, float& hit) {
+		clear = 0.0f;
+		hit = 1.0f;
+		for (int i = 0; i < CCD_MAX_ITERATIONS && (hit - clear) * length > CCD_TOLERANCE; i++) {
+			const float middle = 0.5f * (clear + hit);
+			if (hits(middle)) {
+				hit = middle;
+			} else {
+				clear = middle;
+			}
+		}
+	}
+
+	// timeOfImpact for two placed convex shapes.
+	template<class A, class B>
+	bool sweep(const A& p, glm::vec3 motion, const B& q, glm::vec3 initialAxis, float& t, glm::vec3& normal) {
+		auto hits = [&](float time) {
+			Simplex simplex;
+			return gjk(Swept<A>{ p, motion * time }, q, simplex, initialAxis);
+		};
+		if (!hits(1.0f) || hits(0.0f)) {
+			return false;
+		}
+		float hit;
+		bisect(hits, glm::length(motion), t, hit);
+
+		// The normal where the shapes just overlap, or the motion if EPA gives up on the tiny overlap
+		const Placed<A> moved{ p, motion * hit };
+		Simplex simplex;
+		Contact contact;
+		normal = glm::normalize(motion);
+		if (gjk(moved, q, simplex, initialAxis) && epa(moved, q, simplex, contact)) {
+			normal = contact.Normal;
+		}
+		return true;
+	}
+
+	// Sweeps against every triangle of the heightfield under the swept bounds of the shape and
+	// keeps the first impact. The normal is that of the triangle hit, as in collide.
+	template<class A>
+	bool sweepConcave(const A& p, glm::vec3 motion, const HeightField& field, glm::vec3 fieldPosition, float& t, glm::vec3& normal) {
+		const BoundingBox bounds = supportBounds(Swept<A>{ p, motion });
+		bool found = false;
+		forEachPrism(*field.Data, fieldPosition, bounds.min, bounds.max, [&](const HeightFieldPrism& prism) {
+			float time;
+			glm::vec3 unused;
+			if (sweep(p, motion, prism, -prism.Normal, time, unused) && (!found || time < t)) {
+				t = time;
+				normal = -prism.Normal;
+				found = true;
+			}
+		});
+		return found;
+	}
+
+	// Bisects against the level's solid with BSPTree::penetration of the swept shape. The normal
+	// is that of the face the shape is pushed out through where it first overlaps.
+	template<class A>
+	bool sweepConcave(const A& p, glm::vec3 motion, const Level& level, glm::vec3 levelPosition, float& t, glm::vec3& normal) {
+		const Placed<A> local{ p, -levelPosition };
+		auto hits = [&](float time) {
+			float depth;
+			glm::vec3 unused;
+			return level.Tree->penetration(Swept<Placed<A>>{ local, motion * time }, depth, unused);
+		};
+		if (!hits(1.0f) || hits(0.0f)) {
+			return false;
+		}
+		float hit;
+		bisect(hits, glm::length(motion), t, hit);
+
+		float depth;
+		glm::vec3 outward;
+		normal = glm::normalize(motion);
+		if (level.Tree->penetration(Placed<Placed<A>>{ local, motion * hit }, depth, outward)) {
+			normal = -outward;
+		}
+		return true;
+	}
+}
+
+bool Physics::timeOfImpact(const ColliderShape& a, glm::vec3 positionA, glm::vec3 motion, const ColliderShape& b, glm::vec3 positionB, float& t, glm::vec3& normal) {
+	return std::visit([&](const auto& shapeA, const auto& shapeB) {
+		using A = std::decay_t<decltype(shapeA)>;
+		using B = std::decay_t<decltype(shapeB)>;
+		if constexpr (std::is_same_v<A, std::monostate> || std::is_same_v<B, std::monostate> || isConcave<A>) {
+			return false;
+		} else if constexpr (isConcave<B>) {
+			return sweepConcave(Placed<A>{ shapeA, positionA }, motion, shapeB, positionB, t, normal);
+		} else {
+			const glm::vec3 axis = positionA - positionB;
+			const glm::vec3 initialAxis = glm::dot(axis, axis) > 0.0f ? axis : glm::vec3(1.0f, 0.0f, 0.0f);
+			return sweep(Placed<A>{ shapeA, positionA }, motion, Placed<B>{ shapeB, positionB }, initialAxis, t, normal);
+		}
+	}, a, b);
+}
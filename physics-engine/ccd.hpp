@@ -0,0 +1,35 @@
+#pragma once
+#include "collider.hpp"
+
+namespace Physics {
+
+	// Bodies moving further than this fraction of their smallest extent in one step are swept,
+	// as are bodies flagged as bullets.
+	constexpr float CCD_MOTION_FRACTION = 0.5f;
+	// A swept body is moved to its first time of impact, bounced, and moved on for the rest of the
+	// step, at most this many times. Motion left after the last one is dropped.
+	constexpr int CCD_MAX_SUBSTEPS = 4;
+	// Bisection steps of the time of impact, and the distance along the motion it stops at.
+	constexpr int CCD_MAX_ITERATIONS = 24;
+	constexpr float CCD_TOLERANCE = 1e-3f;
+
+	// A shape swept along a motion: the Minkowski sum of the shape and the segment from 0 to motion.
+	template<class Shape>
+	struct Swept {
+		const Shape& shape;
+		glm::vec3 motion;
+
+		glm::vec3 support(glm::vec3 direction) const {
+			const glm::vec3 point = shape.support(direction);
+			return glm::dot(direction, motion) > 0.0f ? point + motion : point;
+		}
+	};
+
+	// Finds the first time t in [0, 1] at which a moving by motion touches b, which stands still.
+	// The swept volume of a over [0, t] only grows with t, so t is found by bisection, each step
+	// a GJK test of the swept shape. t is the last time known to be clear of b, so moving a by
+	// motion * t never makes the shapes overlap. normal is the contact normal at the impact, from
+	// a towards b. Returns false if a does not hit b, or already touches it at the start (the
+	// contact solver deals with those).
+	bool timeOfImpact(const ColliderShape& a, glm::vec3 positionA, glm::vec3 motion, const ColliderShape& b, glm::vec3 positionB, float& t, glm::vec3& normal);
+}
@@ -12,21 +12,13 @@ void Clock::update() {
 	m_deltaTime = m_currTime - m_prevTime;
 
 	/* Reset tick booleans */
-	m_physTick = m_physTick ? false : m_physTick;
 	m_renderTick = m_renderTick ? false : m_renderTick;
 	m_fpsTick = m_fpsTick ? false : m_fpsTick;
 
 	/* Update tick flags */
-	m_physTick = ((m_currTime - m_physTime) > (1.0f / m_physFreq));
 	m_renderTick = ((m_currTime - m_renderTime) > (1.0f / m_renderFreq));
 	m_fpsTick = ((m_currTime - m_fpsTime) > 1.0f);
 
-	/* Set physics delta */
-	if (m_physTick) {
-		m_physDelta = m_currTime - m_physTime;
-		m_physTime = m_currTime;
-	}
-
 	/* Set render delta */
 	if (m_renderTick) {
 		m_renderDelta = m_currTime - m_renderTime;
@@ -8,26 +8,27 @@ struct Clock {
 	/* The difference between each tick. */
 	double m_deltaTime;
 
-	double m_physTime;
 	/* The last time the render tick was executed. */
 	double m_renderTime;
 	/* The last time the fps tick was executed. */
 	double m_fpsTime;
 
-	/* Frequency of physics. */
-	double m_physFreq = 1000.0f;
+	/* Frequency of physics, stepped by PhysicsSim on its own thread. Rendering interpolates
+	   between steps, so it can be well below the render frequency. */
+	double m_physFreq = 120.0f;
 	/* Frequency of rendering. */
 	double m_renderFreq = 244.0f;
 
-	/* Flag determining if we should run physics. */
-	bool m_physTick;
 	/* Flag determining if we should run rendering. */
 	bool m_renderTick;
 	/* Flag determining if we should run fps timer. */
 	bool m_fpsTick;
 
-	/* Time between subsequent physics sim ticks. */
-	double m_physDelta;
+	/* Fixed time step of the physics simulation. */
+	double m_physDelta = 1.0 / m_physFreq;
+	/* Most physics steps run at once to catch up after a stall. Time beyond that is dropped, so
+	   that a slow step does not make the next ones slower still. */
+	int m_maxPhysSteps = 8;
 	/* Time between subsequent render ticks. */
 	double m_renderDelta;
 	/* Time between subsequent fps ticks. */
@@ -39,11 +40,6 @@ struct Clock {
 	/* Update the clock times, set flags, etc. */
 	void update();
 
-	/* Are we in a physics tick? */
-	inline bool isPhysicsTick() const  {
-		return m_physTick;
-	}
-
 	/* Are we in a render tick? */
 	inline bool isRenderTick() const {
 		return m_renderTick;
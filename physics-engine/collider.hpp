@@ -0,0 +1,100 @@
+#pragma once
+#include <cfloat>
+#include <memory>
+#include <type_traits>
+#include <variant>
+#include <glm/glm.hpp>
+#include "hull.hpp"
+#include "heightfield.hpp"
+#include "bsp.hpp"
+
+namespace Physics {
+
+	/*
+	* 
+	* Convex collision shapes. Each has a non-virtual support function, the furthest point of the
+	* shape in a direction, in the shape's local space. Shapes do not rotate with the body.
+	* 
+	*/
+	struct Sphere {
+		float Radius;
+
+		glm::vec3 support(glm::vec3 direction) const {
+			const float length = glm::length(direction);
+			return length > 0.0f ? direction * (Radius / length) : glm::vec3(Radius, 0.0f, 0.0f);
+		}
+	};
+
+	struct Box {
+		glm::vec3 Min;
+		glm::vec3 Max;
+
+		glm::vec3 support(glm::vec3 direction) const {
+			return glm::vec3(
+				direction.x >= 0.0f ? Max.x : Min.x,
+				direction.y >= 0.0f ? Max.y : Min.y,
+				direction.z >= 0.0f ? Max.z : Min.z);
+		}
+	};
+
+	// A capsule along the y axis: a segment from -HalfHeight to HalfHeight swept by a sphere.
+	struct Capsule {
+		float Radius;
+		float HalfHeight;
+
+		glm::vec3 support(glm::vec3 direction) const {
+			const glm::vec3 cap = glm::vec3(0.0f, direction.y >= 0.0f ? HalfHeight : -HalfHeight, 0.0f);
+			return cap + Sphere{ Radius }.support(direction);
+		}
+	};
+
+	// A convex hull, see buildHull. Hulls are shared between all bodies using the same shape.
+	struct ConvexHull {
+		std::shared_ptr<const HullMesh> Mesh;
+		// The last support vertex of this body, where the next hill climb starts. Support
+		// directions change little between GJK iterations and frames, so the walk is short.
+		// Only the physics step collides hulls, on one thread.
+		mutable uint32_t Hint = 0;
+
+		glm::vec3 support(glm::vec3 direction) const {
+			if (!Mesh->canHillClimb()) {
+				return Mesh->Vertices[Mesh->supportBruteForce(direction)];
+			}
+			Hint = Mesh->supportHillClimb(direction, Hint);
+			return Mesh->Vertices[Hint];
+		}
+	};
+
+	// The collider of a rigid body. std::monostate means the body has not been given one, the
+	// physics system then uses the body's bounding box. All but HeightField and Level are convex.
+	using ColliderShape = std::variant<std::monostate, Sphere, Box, Capsule, ConvexHull, HeightField, Level>;
+
+	// Shapes of static bodies that are not convex. Convex shapes are collided and swept against
+	// them with queries of their own instead of GJK; two of them never touch.
+	template<class Shape>
+	constexpr bool isConcave = std::is_same_v<Shape, HeightField> || std::is_same_v<Shape, Level>;
+
+	// Bounds of a convex shape in its local space, from its support along the six axes.
+	template<class Shape>
+	BoundingBox supportBounds(const Shape& shape) {
+		glm::vec3 min, max;
+		for (int axis = 0; axis < 3; axis++) {
+			glm::vec3 direction(0.0f);
+			direction[axis] = 1.0f;
+			max[axis] = shape.support(direction)[axis];
+			min[axis] = shape.support(-direction)[axis];
+		}
+		return BoundingBox(min, max);
+	}
+
+	// A shape placed in the world.
+	template<class Shape>
+	struct Placed {
+		const Shape& shape;
+		glm::vec3 position;
+
+		glm::vec3 support(glm::vec3 direction) const {
+			return position + shape.support(direction);
+		}
+	};
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+
+namespace Physics {
+
+	// A bitfield of collision layers. A body belongs to the layers in its layer field and
+	// collides with the layers in its mask field.
+	using CollisionLayer = uint32_t;
+
+	namespace Layers {
+		constexpr CollisionLayer None		= 0;
+		constexpr CollisionLayer Default	= 1u << 0;
+		constexpr CollisionLayer Static		= 1u << 1;
+		constexpr CollisionLayer Debris		= 1u << 2;
+		constexpr CollisionLayer Player		= 1u << 3;
+		constexpr CollisionLayer Sensor		= 1u << 4;
+		constexpr CollisionLayer All		= 0xFFFFFFFFu;
+	}
+
+	// Two bodies are only paired if each one's layer is accepted by the other's mask.
+	// e.g. debris with mask (All & ~Debris) never collides with other debris, and a sensor with
+	// mask Player only sees players.
+	inline bool shouldCollide(CollisionLayer layerA, CollisionLayer maskA, CollisionLayer layerB, CollisionLayer maskB) {
+		return (layerA & maskB) != 0 && (layerB & maskA) != 0;
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "types.hpp"
+
+namespace Physics {
+
+	// Events the buffer has room for up front. A step with more grows it, no event is dropped.
+	constexpr size_t CONTACT_EVENT_CAPACITY = 4096;
+
+	enum class ContactEventType : uint8_t {
+		// Two solid bodies, or a body and a plane, started touching.
+		ContactBegin,
+		// They still touch. Only reported for pairs with a body awake and stepping, and only when
+		// asked for, see ContactEventBuffer::setPersist.
+		ContactPersist,
+		// They stopped touching, moved apart or one of them was removed.
+		ContactEnd,
+		// A body entered or left a sensor, see Components::RigidBody::Sensor.
+		TriggerEnter,
+		TriggerExit
+	};
+
+	// A change in the contact between two bodies, or a body and a static plane. For a plane B is
+	// MAX_ENTITIES and Plane is its id. The entities of an end event may have been removed already.
+	struct ContactEvent {
+		ContactEventType Type = ContactEventType::ContactBegin;
+		Entity A = MAX_ENTITIES;
+		Entity B = MAX_ENTITIES;
+		uint32_t Plane = 0;
+		// From A towards B, and the deepest point on A in world space. Zero for end and exit events.
+		glm::vec3 Normal = glm::vec3(0.0f);
+		glm::vec3 Point = glm::vec3(0.0f);
+		float Depth = 0.0f;
+	};
+
+	// The events of one step. The storage is kept from step to step and only grows while a step
+	// has more events than any before, so the step can report every contact as it goes without
+	// calling anyone back; systems read the events once the step is done.
+	class ContactEventBuffer {
+	public:
+		ContactEventBuffer() { m_events.reserve(CONTACT_EVENT_CAPACITY); }
+
+		void clear() { m_events.clear(); }
+		void push(const ContactEvent& event) { m_events.push_back(event); }
+
+		// Persist events are off by default: a pile at rest would report every one of its
+		// contacts every step.
+		bool getPersist() const { return m_persist; }
+		void setPersist(bool persist) { m_persist = persist; }
+
+		std::span<const ContactEvent> get() const { return std::span<const ContactEvent>(m_events.data(), m_events.size()); }
+	private:
+		std::vector<ContactEvent> m_events;
+		bool m_persist = false;
+	};
+}
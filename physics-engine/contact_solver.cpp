@@ -0,0 +1,449 @@
+#include "contact_solver.hpp"
+#include "simd.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <execution>
+#include <numeric>
+
+using namespace Physics;
+
+namespace {
+	using namespace Physics::Simd;
+
+	constexpr size_t LANES = width<FloatN>;
+
+	// A batch holds LANES rows. Each column is LANES floats, the columns of a batch are contiguous.
+	// Padding lanes are all zero and refer to the static body, so they never change anything.
+	enum Column {
+		NX, NY, NZ,
+		T1X, T1Y, T1Z,
+		T2X, T2Y, T2Z,
+		// 1 / (inverse mass of A + inverse mass of B). Without rotation it is the same for all three axes.
+		MASS,
+		VELOCITY_BIAS,
+		POSITION_BIAS,
+		FRICTION,
+		NORMAL_IMPULSE,
+		TANGENT_IMPULSE_1,
+		TANGENT_IMPULSE_2,
+		POSITION_IMPULSE,
+		COLUMN_COUNT
+	};
+
+	float& at(std::vector<float>& rows, size_t row, Column column) {
+		return rows[((row / LANES) * COLUMN_COUNT + column) * LANES + row % LANES];
+	}
+
+	// Two unit vectors perpendicular to n and to each other. Depends only on n, so the friction
+	// impulses of a persistent contact point stay valid from one step to the next.
+	void tangents(glm::vec3 n, glm::vec3& t1, glm::vec3& t2) {
+		if (std::abs(n.x) >= 0.57735f) {
+			t1 = glm::normalize(glm::vec3(n.y, -n.x, 0.0f));
+		} else {
+			t1 = glm::normalize(glm::vec3(0.0f, n.z, -n.y));
+		}
+		t2 = glm::cross(n, t1);
+	}
+
+	struct BodyArrays {
+		float* x;
+		float* y;
+		float* z;
+		const float* inverseMass;
+	};
+
+	template<class V>
+	V gather(const float* source, const uint32_t* bodies) {
+		float lanes[width<V>];
+		for (size_t i = 0; i < width<V>; i++) {
+			lanes[i] = source[bodies[i]];
+		}
+		return load<V>(lanes);
+	}
+
+	// The static body never changes, and is left alone since other threads may be reading it.
+	template<class V>
+	void scatter(float* target, const uint32_t* bodies, V value) {
+		float lanes[width<V>];
+		store(lanes, value);
+		for (size_t i = 0; i < width<V>; i++) {
+			if (bodies[i] != STATIC_SOLVER_BODY) {
+				target[bodies[i]] = lanes[i];
+			}
+		}
+	}
+
+	// Calls function(i) for every i in indices, in parallel.
+	template<class Function>
+	void parallelFor(std::span<const uint32_t> indices, Function&& function) {
+		std::for_each(std::execution::par, indices.begin(), indices.end(), [&](uint32_t i) {
+			function(i);
+		});
+	}
+
+	// One iteration over a batch: friction along both tangents, bounded by the normal impulse,
+	// then the normal. Impulses are accumulated and clamped, the change is applied to the bodies.
+	template<class V>
+	void solveVelocityBatch(float* batch, const uint32_t* bodyA, const uint32_t* bodyB, const BodyArrays& bodies) {
+		auto column = [batch](Column c) { return batch + c * LANES; };
+		const V inverseMassA = gather<V>(bodies.inverseMass, bodyA);
+		const V inverseMassB = gather<V>(bodies.inverseMass, bodyB);
+		V ax = gather<V>(bodies.x, bodyA), ay = gather<V>(bodies.y, bodyA), az = gather<V>(bodies.z, bodyA);
+		V bx = gather<V>(bodies.x, bodyB), by = gather<V>(bodies.y, bodyB), bz = gather<V>(bodies.z, bodyB);
+		const V mass = load<V>(column(MASS));
+
+		auto apply = [&](V dx, V dy, V dz, V impulse) {
+			const V ia = impulse * inverseMassA;
+			const V ib = impulse * inverseMassB;
+			ax = ax - dx * ia; ay = ay - dy * ia; az = az - dz * ia;
+			bx = bx + dx * ib; by = by + dy * ib; bz = bz + dz * ib;
+		};
+
+		const V limit = load<V>(column(FRICTION)) * load<V>(column(NORMAL_IMPULSE));
+		auto friction = [&](Column axis, Column accumulated) {
+			const V tx = load<V>(column(axis)), ty = load<V>(column(Column(axis + 1))), tz = load<V>(column(Column(axis + 2)));
+			const V speed = (bx - ax) * tx + (by - ay) * ty + (bz - az) * tz;
+			const V previous = load<V>(column(accumulated));
+			const V impulse = min(max(previous - mass * speed, -limit), limit);
+			store(column(accumulated), impulse);
+			apply(tx, ty, tz, impulse - previous);
+		};
+		friction(T1X, TANGENT_IMPULSE_1);
+		friction(T2X, TANGENT_IMPULSE_2);
+
+		const V nx = load<V>(column(NX)), ny = load<V>(column(NY)), nz = load<V>(column(NZ));
+		const V approach = (bx - ax) * nx + (by - ay) * ny + (bz - az) * nz;
+		const V previous = load<V>(column(NORMAL_IMPULSE));
+		// Contacts can only push
+		const V impulse = max(previous + mass * (load<V>(column(VELOCITY_BIAS)) - approach), splat<V>(0.0f));
+		store(column(NORMAL_IMPULSE), impulse);
+		apply(nx, ny, nz, impulse - previous);
+
+		scatter(bodies.x, bodyA, ax); scatter(bodies.y, bodyA, ay); scatter(bodies.z, bodyA, az);
+		scatter(bodies.x, bodyB, bx); scatter(bodies.y, bodyB, by); scatter(bodies.z, bodyB, bz);
+	}
+
+	// Split impulse: the same normal constraint on the pseudo velocities, aiming for the
+	// separation speed that removes the penetration.
+	template<class V>
+	void solvePositionBatch(float* batch, const uint32_t* bodyA, const uint32_t* bodyB, const BodyArrays& bodies) {
+		auto column = [batch](Column c) { return batch + c * LANES; };
+		const V inverseMassA = gather<V>(bodies.inverseMass, bodyA);
+		const V inverseMassB = gather<V>(bodies.inverseMass, bodyB);
+		const V ax = gather<V>(bodies.x, bodyA), ay = gather<V>(bodies.y, bodyA), az = gather<V>(bodies.z, bodyA);
+		const V bx = gather<V>(bodies.x, bodyB), by = gather<V>(bodies.y, bodyB), bz = gather<V>(bodies.z, bodyB);
+
+		const V nx = load<V>(column(NX)), ny = load<V>(column(NY)), nz = load<V>(column(NZ));
+		const V approach = (bx - ax) * nx + (by - ay) * ny + (bz - az) * nz;
+		const V previous = load<V>(column(POSITION_IMPULSE));
+		const V impulse = max(previous + load<V>(column(MASS)) * (load<V>(column(POSITION_BIAS)) - approach), splat<V>(0.0f));
+		store(column(POSITION_IMPULSE), impulse);
+
+		const V ia = (impulse - previous) * inverseMassA;
+		const V ib = (impulse - previous) * inverseMassB;
+		scatter(bodies.x, bodyA, ax - nx * ia); scatter(bodies.y, bodyA, ay - ny * ia); scatter(bodies.z, bodyA, az - nz * ia);
+		scatter(bodies.x, bodyB, bx + nx * ib); scatter(bodies.y, bodyB, by + ny * ib); scatter(bodies.z, bodyB, bz + nz * ib);
+	}
+}
+
+void ContactSolver::begin() {
+	m_manifolds.clear();
+	m_velocityX.clear();
+	m_velocityY.clear();
+	m_velocityZ.clear();
+	m_inverseMass.clear();
+	addBody(glm::vec3(0.0f), 0.0f);
+}
+
+uint32_t ContactSolver::addBody(glm::vec3 velocity, float inverseMass) {
+	m_velocityX.push_back(velocity.x);
+	m_velocityY.push_back(velocity.y);
+	m_velocityZ.push_back(velocity.z);
+	m_inverseMass.push_back(inverseMass);
+	return static_cast<uint32_t>(m_inverseMass.size() - 1);
+}
+
+void ContactSolver::addManifold(ContactManifold& manifold, uint32_t bodyA, uint32_t bodyB, float restitution, float friction) {
+	m_manifolds.push_back(ManifoldEntry{ &manifold, bodyA, bodyB, restitution, friction });
+}
+
+void ContactSolver::solve(const SolverSettings& settings, float deltaTime) {
+	const size_t bodyCount = m_inverseMass.size();
+	m_pseudoX.assign(bodyCount, 0.0f);
+	m_pseudoY.assign(bodyCount, 0.0f);
+	m_pseudoZ.assign(bodyCount, 0.0f);
+
+	buildRows(settings, deltaTime);
+
+	size_t sequence = m_groups.size();
+	for (const ColorRange& color : m_colors) {
+		sequence = std::max<size_t>(sequence, color.batchCount / SOLVER_PARALLEL_BATCHES + 1);
+	}
+	if (m_sequence.size() < sequence) {
+		m_sequence.resize(sequence);
+		std::iota(m_sequence.begin(), m_sequence.end(), 0);
+	}
+
+	// Small groups one task each, then the large ones one after another with parallel colors
+	parallelFor(std::span<const uint32_t>(m_sequence.data(), m_groups.size()), [&](uint32_t group) {
+		if (m_groups[group].batchCount < SOLVER_LARGE_GROUP_BATCHES) {
+			solveGroup(m_groups[group], settings, false);
+		}
+	});
+	for (const GroupRange& group : m_groups) {
+		if (group.batchCount >= SOLVER_LARGE_GROUP_BATCHES) {
+			solveGroup(group, settings, true);
+		}
+	}
+
+	storeImpulses();
+}
+
+void ContactSolver::solveGroup(const GroupRange& group, const SolverSettings& settings, bool parallel) {
+	warmStart(group);
+
+	auto solveColors = [&](auto&& solveBatch) {
+		for (uint32_t c = group.firstColor; c < group.firstColor + group.colorCount; c++) {
+			const ColorRange color = m_colors[c];
+			if (!parallel || color.batchCount <= SOLVER_PARALLEL_BATCHES) {
+				for (uint32_t batch = color.firstBatch; batch < color.firstBatch + color.batchCount; batch++) {
+					solveBatch(batch);
+				}
+				continue;
+			}
+			const uint32_t tasks = (color.batchCount + SOLVER_PARALLEL_BATCHES - 1) / SOLVER_PARALLEL_BATCHES;
+			parallelFor(std::span<const uint32_t>(m_sequence.data(), tasks), [&](uint32_t task) {
+				const uint32_t first = color.firstBatch + task * SOLVER_PARALLEL_BATCHES;
+				const uint32_t last = std::min(first + SOLVER_PARALLEL_BATCHES, color.firstBatch + color.batchCount);
+				for (uint32_t batch = first; batch < last; batch++) {
+					solveBatch(batch);
+				}
+			});
+		}
+	};
+
+	const BodyArrays velocity{ m_velocityX.data(), m_velocityY.data(), m_velocityZ.data(), m_inverseMass.data() };
+	for (int iteration = 0; iteration < settings.VelocityIterations; iteration++) {
+		solveColors([&](uint32_t batch) {
+			solveVelocityBatch<FloatN>(m_rows.data() + batch * COLUMN_COUNT * LANES, m_rowBodyA.data() + batch * LANES, m_rowBodyB.data() + batch * LANES, velocity);
+		});
+	}
+
+	if (settings.SplitImpulse) {
+		const BodyArrays pseudo{ m_pseudoX.data(), m_pseudoY.data(), m_pseudoZ.data(), m_inverseMass.data() };
+		for (int iteration = 0; iteration < settings.PositionIterations; iteration++) {
+			solveColors([&](uint32_t batch) {
+				solvePositionBatch<FloatN>(m_rows.data() + batch * COLUMN_COUNT * LANES, m_rowBodyA.data() + batch * LANES, m_rowBodyB.data() + batch * LANES, pseudo);
+			});
+		}
+	}
+}
+
+void ContactSolver::buildRows(const SolverSettings& settings, float deltaTime) {
+	m_rows.clear();
+	m_rowBodyA.clear();
+	m_rowBodyB.clear();
+	m_rowPoints.clear();
+	m_colors.clear();
+	m_groups.clear();
+
+	// Islands over the moving bodies, numbered in the order of their first manifold
+	const size_t bodyCount = m_inverseMass.size();
+	m_islands.reset(bodyCount);
+	for (const ManifoldEntry& entry : m_manifolds) {
+		if (entry.a != STATIC_SOLVER_BODY && entry.b != STATIC_SOLVER_BODY) {
+			m_islands.join(entry.a, entry.b);
+		}
+	}
+	m_islandIndex.assign(bodyCount, UINT32_MAX);
+	m_entryIsland.assign(m_manifolds.size(), UINT32_MAX);
+	uint32_t islandCount = 0;
+	for (size_t i = 0; i < m_manifolds.size(); i++) {
+		const ManifoldEntry& entry = m_manifolds[i];
+		if (m_inverseMass[entry.a] + m_inverseMass[entry.b] == 0.0f) {
+			continue;
+		}
+		uint32_t& island = m_islandIndex[m_islands.find(entry.a != STATIC_SOLVER_BODY ? entry.a : entry.b)];
+		if (island == UINT32_MAX) {
+			island = islandCount++;
+		}
+		m_entryIsland[i] = island;
+	}
+
+	// Counting sort of the manifolds by island, keeping their order within an island
+	m_islandOffsets.assign(islandCount + 1, 0);
+	for (uint32_t island : m_entryIsland) {
+		if (island != UINT32_MAX) {
+			m_islandOffsets[island + 1]++;
+		}
+	}
+	std::partial_sum(m_islandOffsets.begin(), m_islandOffsets.end(), m_islandOffsets.begin());
+	m_islandEntries.resize(m_islandOffsets.back());
+	m_cursor.assign(m_islandOffsets.begin(), m_islandOffsets.end() - 1);
+	for (uint32_t i = 0; i < m_entryIsland.size(); i++) {
+		if (m_entryIsland[i] != UINT32_MAX) {
+			m_islandEntries[m_cursor[m_entryIsland[i]]++] = i;
+		}
+	}
+
+	// Consecutive islands, consecutive in m_islandEntries too, are gathered into groups
+	m_bodyColors.assign(bodyCount, 0);
+	uint32_t first = 0;
+	uint32_t rows = 0;
+	for (uint32_t island = 0; island < islandCount; island++) {
+		const uint32_t end = m_islandOffsets[island + 1];
+		for (uint32_t i = m_islandOffsets[island]; i < end; i++) {
+			rows += m_manifolds[m_islandEntries[i]].manifold->PointCount;
+		}
+		if (rows >= SOLVER_GROUP_ROWS || island + 1 == islandCount) {
+			buildGroup(std::span<const uint32_t>(m_islandEntries.data() + first, end - first), settings, deltaTime);
+			first = end;
+			rows = 0;
+		}
+	}
+}
+
+// Colors the rows of a group greedily, each gets the first color neither of its moving bodies
+// uses yet. Islands share the colors, their bodies are apart. Each color is then packed into
+// batches, filled across islands.
+void ContactSolver::buildGroup(std::span<const uint32_t> entries, const SolverSettings& settings, float deltaTime) {
+	m_pending.clear();
+	uint32_t colorCount = 0;
+	uint32_t ownColor = SOLVER_MAX_COLORS;
+	for (uint32_t index : entries) {
+		const ManifoldEntry& entry = m_manifolds[index];
+		for (uint32_t i = 0; i < entry.manifold->PointCount; i++) {
+			uint64_t used = 0;
+			for (uint32_t body : { entry.a, entry.b }) {
+				if (body != STATIC_SOLVER_BODY) {
+					used |= m_bodyColors[body];
+				}
+			}
+			uint32_t color = ownColor;
+			if (~used != 0) {
+				color = static_cast<uint32_t>(std::countr_zero(~used));
+				for (uint32_t body : { entry.a, entry.b }) {
+					if (body != STATIC_SOLVER_BODY) {
+						m_bodyColors[body] |= uint64_t(1) << color;
+					}
+				}
+			} else {
+				ownColor++;
+			}
+			colorCount = std::max(colorCount, color + 1);
+			m_pending.push_back(PendingRow{ index, i, color });
+		}
+	}
+
+	m_colorOffsets.assign(colorCount + 1, 0);
+	for (const PendingRow& pending : m_pending) {
+		m_colorOffsets[pending.color + 1]++;
+	}
+	std::partial_sum(m_colorOffsets.begin(), m_colorOffsets.end(), m_colorOffsets.begin());
+	m_sorted.resize(m_pending.size());
+	m_cursor.assign(m_colorOffsets.begin(), m_colorOffsets.end() - 1);
+	for (const PendingRow& pending : m_pending) {
+		m_sorted[m_cursor[pending.color]++] = pending;
+	}
+
+	GroupRange group{ static_cast<uint32_t>(m_colors.size()), 0, static_cast<uint32_t>(m_rowPoints.size() / LANES), 0 };
+	for (uint32_t color = 0; color < colorCount; color++) {
+		const uint32_t first = m_colorOffsets[color];
+		const uint32_t count = m_colorOffsets[color + 1] - first;
+		if (count == 0) {
+			continue;
+		}
+		const uint32_t batches = static_cast<uint32_t>((count + LANES - 1) / LANES);
+		const size_t firstRow = m_rowPoints.size();
+		m_colors.push_back(ColorRange{ static_cast<uint32_t>(firstRow / LANES), batches });
+		m_rows.resize(m_rows.size() + batches * COLUMN_COUNT * LANES, 0.0f);
+		m_rowBodyA.resize(m_rowBodyA.size() + batches * LANES, STATIC_SOLVER_BODY);
+		m_rowBodyB.resize(m_rowBodyB.size() + batches * LANES, STATIC_SOLVER_BODY);
+		m_rowPoints.resize(m_rowPoints.size() + batches * LANES, nullptr);
+		for (uint32_t i = 0; i < count; i++) {
+			const PendingRow& pending = m_sorted[first + i];
+			const ManifoldEntry& entry = m_manifolds[pending.entry];
+			writeRow(firstRow + i, entry, entry.manifold->Points[pending.point], settings, deltaTime);
+		}
+		group.colorCount++;
+		group.batchCount += batches;
+	}
+	m_groups.push_back(group);
+}
+
+void ContactSolver::writeRow(size_t row, const ManifoldEntry& entry, ContactPoint& point, const SolverSettings& settings, float deltaTime) {
+	const glm::vec3 n = entry.manifold->Normal;
+	glm::vec3 t1, t2;
+	tangents(n, t1, t2);
+
+	// Bodies do not rotate, so every point of the manifold has the same relative velocity.
+	const float approach = glm::dot(getVelocity(entry.b) - getVelocity(entry.a), n);
+	float bounce = 0.0f;
+	if (approach < -settings.RestitutionThreshold) {
+		bounce = -entry.restitution * approach;
+	}
+	// Only resting contacts are warm started. The impulse of an impact, or of a bounce in
+	// the last step, would otherwise be applied a second time.
+	if (std::abs(approach) > settings.RestitutionThreshold) {
+		point.NormalImpulse = 0.0f;
+		point.TangentImpulse[0] = point.TangentImpulse[1] = 0.0f;
+	}
+	const float correction = std::min(settings.Baumgarte / deltaTime * std::max(point.Depth - settings.Slop, 0.0f), settings.MaxCorrectionSpeed);
+
+	m_rowBodyA[row] = entry.a;
+	m_rowBodyB[row] = entry.b;
+	m_rowPoints[row] = &point;
+	at(m_rows, row, NX) = n.x;
+	at(m_rows, row, NY) = n.y;
+	at(m_rows, row, NZ) = n.z;
+	at(m_rows, row, T1X) = t1.x;
+	at(m_rows, row, T1Y) = t1.y;
+	at(m_rows, row, T1Z) = t1.z;
+	at(m_rows, row, T2X) = t2.x;
+	at(m_rows, row, T2Y) = t2.y;
+	at(m_rows, row, T2Z) = t2.z;
+	at(m_rows, row, MASS) = 1.0f / (m_inverseMass[entry.a] + m_inverseMass[entry.b]);
+	at(m_rows, row, VELOCITY_BIAS) = settings.SplitImpulse ? bounce : std::max(bounce, correction);
+	at(m_rows, row, POSITION_BIAS) = settings.SplitImpulse ? correction : 0.0f;
+	at(m_rows, row, FRICTION) = entry.friction;
+	at(m_rows, row, NORMAL_IMPULSE) = point.NormalImpulse;
+	at(m_rows, row, TANGENT_IMPULSE_1) = point.TangentImpulse[0];
+	at(m_rows, row, TANGENT_IMPULSE_2) = point.TangentImpulse[1];
+	at(m_rows, row, POSITION_IMPULSE) = 0.0f;
+}
+
+// Applies the impulses of the last step, so resting contacts start out nearly solved.
+void ContactSolver::warmStart(const GroupRange& group) {
+	auto apply = [this](uint32_t body, glm::vec3 impulse) {
+		if (body != STATIC_SOLVER_BODY) {
+			m_velocityX[body] += impulse.x * m_inverseMass[body];
+			m_velocityY[body] += impulse.y * m_inverseMass[body];
+			m_velocityZ[body] += impulse.z * m_inverseMass[body];
+		}
+	};
+	const size_t end = (group.firstBatch + group.batchCount) * LANES;
+	for (size_t row = group.firstBatch * LANES; row < end; row++) {
+		if (m_rowPoints[row] == nullptr) {
+			continue;
+		}
+		const glm::vec3 n(at(m_rows, row, NX), at(m_rows, row, NY), at(m_rows, row, NZ));
+		const glm::vec3 t1(at(m_rows, row, T1X), at(m_rows, row, T1Y), at(m_rows, row, T1Z));
+		const glm::vec3 t2(at(m_rows, row, T2X), at(m_rows, row, T2Y), at(m_rows, row, T2Z));
+		const glm::vec3 impulse = n * at(m_rows, row, NORMAL_IMPULSE) + t1 * at(m_rows, row, TANGENT_IMPULSE_1) + t2 * at(m_rows, row, TANGENT_IMPULSE_2);
+		apply(m_rowBodyA[row], -impulse);
+		apply(m_rowBodyB[row], impulse);
+	}
+}
+
+void ContactSolver::storeImpulses() {
+	for (size_t row = 0; row < m_rowPoints.size(); row++) {
+		ContactPoint* point = m_rowPoints[row];
+		if (point == nullptr) {
+			continue;
+		}
+		point->NormalImpulse = at(m_rows, row, NORMAL_IMPULSE);
+		point->TangentImpulse[0] = at(m_rows, row, TANGENT_IMPULSE_1);
+		point->TangentImpulse[1] = at(m_rows, row, TANGENT_IMPULSE_2);
+	}
+}
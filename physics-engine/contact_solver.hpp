@@ -0,0 +1,130 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "manifold.hpp"
+#include "island.hpp"
+
+namespace Physics {
+
+	struct SolverSettings {
+		int VelocityIterations = 8;
+		// Iterations of the split impulse pass. Unused with SplitImpulse off.
+		int PositionIterations = 3;
+		// Fraction of the penetration removed per step, and penetration that is left alone.
+		float Baumgarte = 0.2f;
+		float Slop = 0.01f;
+		// Deep overlaps (e.g. bodies spawned inside each other) are pushed out no faster than this.
+		float MaxCorrectionSpeed = 2.0f;
+		// Below this approach speed contacts do not bounce, it would only make resting bodies jitter.
+		float RestitutionThreshold = 1.0f;
+		// Push overlapping bodies apart with pseudo velocities that only last for the step, so the
+		// correction adds no energy. Otherwise it is added to the velocity bias (Baumgarte).
+		bool SplitImpulse = true;
+	};
+
+	// Every anchored body is solved as this one: no velocity, infinite mass.
+	constexpr uint32_t STATIC_SOLVER_BODY = 0;
+
+	// Colors tracked per body. Rows that find all of them taken get a color of their own.
+	constexpr uint32_t SOLVER_MAX_COLORS = 64;
+	// Islands are gathered into groups of at least this many rows, each solved as one task.
+	constexpr uint32_t SOLVER_GROUP_ROWS = 256;
+	// Groups with at least this many batches also solve each color in parallel,
+	// SOLVER_PARALLEL_BATCHES batches per task.
+	constexpr uint32_t SOLVER_LARGE_GROUP_BATCHES = 64;
+	constexpr uint32_t SOLVER_PARALLEL_BATCHES = 16;
+
+	// Sequential impulse contact solver. Each contact point becomes a row with a normal and two
+	// friction constraints. Rows are stored structure-of-arrays in batches as wide as the SIMD
+	// width, so that a batch is solved in one pass over its lanes.
+	//
+	// Manifolds are split into islands over the moving bodies. Consecutive islands are gathered
+	// into groups of at least SOLVER_GROUP_ROWS rows, so that a pile of lone bodies on the ground
+	// fills whole batches and tasks instead of one each, and the rows of each group are colored
+	// so that no moving body appears twice in a color. Groups are solved in parallel, large ones
+	// also solve the batches of one color in parallel. Islands never share a moving body, so each
+	// is solved as it would be alone. Groups, colors and batches only depend on the order
+	// manifolds were added in, and rows that run at the same time never share a moving body, so
+	// the result is the same for any number of threads.
+	class ContactSolver {
+	public:
+		// Starts a new step with only the static body.
+		void begin();
+		uint32_t addBody(glm::vec3 velocity, float inverseMass);
+		// The manifold must stay alive until solve returns, which writes the impulses back to it.
+		void addManifold(ContactManifold& manifold, uint32_t bodyA, uint32_t bodyB, float restitution, float friction);
+		void solve(const SolverSettings& settings, float deltaTime);
+
+		glm::vec3 getVelocity(uint32_t body) const { return glm::vec3(m_velocityX[body], m_velocityY[body], m_velocityZ[body]); }
+		// Velocity of the position correction, to be added to the velocity for this step only.
+		glm::vec3 getPseudoVelocity(uint32_t body) const { return glm::vec3(m_pseudoX[body], m_pseudoY[body], m_pseudoZ[body]); }
+	private:
+		struct ManifoldEntry {
+			ContactManifold* manifold;
+			uint32_t a;
+			uint32_t b;
+			float restitution;
+			float friction;
+		};
+		struct PendingRow {
+			uint32_t entry;
+			uint32_t point;
+			uint32_t color;
+		};
+		struct ColorRange {
+			uint32_t firstBatch;
+			uint32_t batchCount;
+		};
+		struct GroupRange {
+			uint32_t firstColor;
+			uint32_t colorCount;
+			uint32_t firstBatch;
+			uint32_t batchCount;
+		};
+
+		void buildRows(const SolverSettings& settings, float deltaTime);
+		void buildGroup(std::span<const uint32_t> entries, const SolverSettings& settings, float deltaTime);
+		void writeRow(size_t row, const ManifoldEntry& entry, ContactPoint& point, const SolverSettings& settings, float deltaTime);
+		void solveGroup(const GroupRange& group, const SolverSettings& settings, bool parallel);
+		void warmStart(const GroupRange& group);
+		void storeImpulses();
+	private:
+		std::vector<ManifoldEntry> m_manifolds{};
+
+		/* Bodies */
+		std::vector<float> m_velocityX{};
+		std::vector<float> m_velocityY{};
+		std::vector<float> m_velocityZ{};
+		std::vector<float> m_pseudoX{};
+		std::vector<float> m_pseudoY{};
+		std::vector<float> m_pseudoZ{};
+		std::vector<float> m_inverseMass{};
+		// Colors used by the rows of each body so far.
+		std::vector<uint64_t> m_bodyColors{};
+
+		/* Islands */
+		Islands m_islands;
+		std::vector<uint32_t> m_islandIndex{};
+		std::vector<uint32_t> m_entryIsland{};
+		// Manifold entries sorted by island, with the offset of each island.
+		std::vector<uint32_t> m_islandEntries{};
+		std::vector<uint32_t> m_islandOffsets{};
+		std::vector<PendingRow> m_pending{};
+		std::vector<PendingRow> m_sorted{};
+		std::vector<uint32_t> m_colorOffsets{};
+		// Next free slot of each island or color during the counting sorts.
+		std::vector<uint32_t> m_cursor{};
+
+		/* Rows, see contact_solver.cpp for the layout of a batch */
+		std::vector<float> m_rows{};
+		std::vector<uint32_t> m_rowBodyA{};
+		std::vector<uint32_t> m_rowBodyB{};
+		std::vector<ContactPoint*> m_rowPoints{};
+		std::vector<ColorRange> m_colors{};
+		std::vector<GroupRange> m_groups{};
+		// 0, 1, 2, ... for the parallel loops.
+		std::vector<uint32_t> m_sequence{};
+	};
+}
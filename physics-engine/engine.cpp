@@ -64,6 +64,13 @@ void Engine::init() {
 		m_render.init();
 		m_physics.init();
 
+		/* The ground drawn by the render system: 200 by 200 at y = -5, solid 1 below its surface */
+		m_physics.addPlane(Physics::StaticPlane{
+			.Surface = Plane(-5.0f, glm::vec3(0.0f, 1.0f, 0.0f)),
+			.Bounded = true,
+			.Bounds = BoundingBox(glm::vec3(-100.0f, -6.0f, -100.0f), glm::vec3(100.0f, -5.0f, 100.0f)),
+			});
+
 		/* Create a ton of entities */
 		std::random_device rd;
 		std::mt19937 gen(rd());
@@ -105,7 +112,7 @@ void Engine::init() {
 				.BaseColor = glm::vec3(zero_to_one(gen), zero_to_one(gen), zero_to_one(gen))
 				});
 			m_coordinator.addComponent(entity, Components::RigidBody{
-				.Box = BoundingBox(glm::vec3(-0.5f), glm::vec3(0.5f)),
+				.Box = BoundingBox(glm::vec3(-1.0f), glm::vec3(1.0f)),
 				.Shape = m_resourceManager.getGeometry("cube"),
 				.Anchored = false,
 				.onGround = false,
@@ -113,6 +120,8 @@ void Engine::init() {
 				.Restitution = 1.0f,
 				.Velocity = glm::vec3(0.0f),
 				.Force = glm::vec3(neg_to_pos(gen), neg_to_pos(gen), neg_to_pos(gen)),
+				// The sphere mesh has a radius of 1
+				.Collider = Physics::Sphere{ 1.0f },
 				});
 		}
 
@@ -123,18 +132,23 @@ void Engine::init() {
 }
 
 void Engine::run() {
+	/* Physics runs on its own thread, in fixed steps */
+	m_physics.start(m_clock.m_maxPhysSteps);
+
 	while (m_running) {
 		/* Update the game time */
 		m_clock.update();
-		
-		/* Run physics sim */
-		if (m_clock.isPhysicsTick()) {
-			m_physics.simulate();
-		}
+
+		/* Destroy the bodies physics removed */
+		m_physics.collectRemoved();
 
 		/* Run render */
 		if (m_clock.isRenderTick()) {
-			m_render.render();
+			const PhysicsFrame& frame = m_physics.acquireFrame();
+			m_render.render(frame.bodies, m_physics.getAlpha(frame));
+
+			/* Bodies far from the camera are simulated less often */
+			m_physics.push(PhysicsCommand{ PhysicsCommand::Type::SetViewer, 0, m_render.getCameraPosition() });
 
 			m_window.swapBuffers();
 
@@ -159,6 +173,7 @@ void Engine::run() {
 }
 
 void Engine::destroy() {
+	m_physics.stop();
 	m_window.destroy();
 	glfwTerminate();
 }
@@ -0,0 +1,93 @@
+#include "epa.hpp"
+#include <cfloat>
+
+using namespace Physics;
+
+bool Polytope::addFace(uint8_t a, uint8_t b, uint8_t c) {
+	glm::vec3 normal = glm::cross(m_vertices[b] - m_vertices[a], m_vertices[c] - m_vertices[a]);
+	const float length = glm::length(normal);
+	if (length < 1e-12f) {
+		return false;
+	}
+	normal /= length;
+	// Orient the face away from the inside of the polytope.
+	if (glm::dot(normal, m_vertices[a] - m_interior) < 0.0f) {
+		normal = -normal;
+		std::swap(b, c);
+	}
+	m_faces[m_faceCount++] = Face{ a, b, c, normal, glm::dot(normal, m_vertices[a]) };
+	return true;
+}
+
+bool Polytope::buildTetrahedron() {
+	m_interior = (m_vertices[0] + m_vertices[1] + m_vertices[2] + m_vertices[3]) * 0.25f;
+	return addFace(0, 1, 2) && addFace(0, 3, 1) && addFace(0, 2, 3) && addFace(1, 3, 2);
+}
+
+size_t Polytope::closestFace() const {
+	size_t closest = 0;
+	float distance = FLT_MAX;
+	for (size_t i = 0; i < m_faceCount; i++) {
+		if (m_faces[i].distance < distance) {
+			distance = m_faces[i].distance;
+			closest = i;
+		}
+	}
+	return closest;
+}
+
+bool Polytope::expand(glm::vec3 point) {
+	if (m_vertexCount == EPA_MAX_VERTICES) {
+		return false;
+	}
+
+	// Find every face the point can see and the edges on the border of that region (the
+	// horizon). Edges shared by two visible faces show up twice, in opposite directions.
+	struct Edge {
+		uint8_t a, b;
+	};
+	std::array<Edge, EPA_MAX_FACES> horizon;
+	std::array<bool, EPA_MAX_FACES> visible;
+	size_t edgeCount = 0;
+	size_t visibleCount = 0;
+	auto addEdge = [&](uint8_t a, uint8_t b) {
+		for (size_t i = 0; i < edgeCount; i++) {
+			if (horizon[i].a == b && horizon[i].b == a) {
+				horizon[i] = horizon[--edgeCount];
+				return;
+			}
+		}
+		horizon[edgeCount++] = Edge{ a, b };
+	};
+
+	for (size_t i = 0; i < m_faceCount; i++) {
+		const Face& face = m_faces[i];
+		visible[i] = glm::dot(face.normal, point - m_vertices[face.a]) > 0.0f;
+		if (visible[i]) {
+			visibleCount++;
+			addEdge(face.a, face.b);
+			addEdge(face.b, face.c);
+			addEdge(face.c, face.a);
+		}
+	}
+	if (visibleCount == 0 || m_faceCount - visibleCount + edgeCount > EPA_MAX_FACES) {
+		return false;
+	}
+
+	// Only modify the polytope once we know the new faces fit.
+	size_t kept = 0;
+	for (size_t i = 0; i < m_faceCount; i++) {
+		if (!visible[i]) {
+			m_faces[kept++] = m_faces[i];
+		}
+	}
+	m_faceCount = kept;
+
+	const uint8_t index = static_cast<uint8_t>(m_vertexCount);
+	m_vertices[m_vertexCount++] = point;
+	for (size_t i = 0; i < edgeCount; i++) {
+		// Skip slivers, the neighbouring faces still close the hull well enough.
+		addFace(horizon[i].a, horizon[i].b, index);
+	}
+	return true;
+}
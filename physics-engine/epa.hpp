@@ -0,0 +1,147 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include "gjk.hpp"
+
+namespace Physics {
+
+	// Result of the narrow phase for an intersecting pair of shapes A and B.
+	struct Contact {
+		// Points from A towards B. Moving A by -Normal * Depth separates the shapes.
+		glm::vec3 Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+		float Depth = 0.0f;
+		// The deepest point of A inside B, and of B inside A.
+		glm::vec3 PointA = glm::vec3(0.0f);
+		glm::vec3 PointB = glm::vec3(0.0f);
+	};
+
+	constexpr size_t EPA_MAX_VERTICES = 128;
+	constexpr size_t EPA_MAX_FACES = 2 * EPA_MAX_VERTICES;
+	constexpr unsigned int EPA_MAX_ITERATIONS = 64;
+	// Stop once the polytope grows by less than this towards the closest face.
+	constexpr float EPA_TOLERANCE = 1e-4f;
+
+	// The polytope expanded by EPA, a convex hull of points of the Minkowski difference.
+	// All storage is fixed-size so that a query never allocates.
+	class Polytope {
+	public:
+		struct Face {
+			uint8_t a, b, c;
+			glm::vec3 normal;
+			float distance;
+		};
+
+		// Builds a tetrahedron from the GJK simplex. Returns false if it is too flat to expand.
+		// support(direction) returns a point of the Minkowski difference, used to complete
+		// simplices with fewer than 4 points.
+		template<class Support>
+		bool init(const Simplex& simplex, Support&& support);
+
+		// Index of the face closest to the origin.
+		size_t closestFace() const;
+		// Adds a point outside the polytope, replacing the faces it can see. Returns false, leaving
+		// the polytope unchanged, when it is out of room or the point is not outside.
+		bool expand(glm::vec3 point);
+
+		const Face& getFace(size_t face) const { return m_faces[face]; }
+		size_t getFaceCount() const { return m_faceCount; }
+	private:
+		// Returns false for degenerate faces, which are not added.
+		bool addFace(uint8_t a, uint8_t b, uint8_t c);
+		bool buildTetrahedron();
+	private:
+		std::array<glm::vec3, EPA_MAX_VERTICES> m_vertices;
+		std::array<Face, EPA_MAX_FACES> m_faces;
+		size_t m_vertexCount{};
+		size_t m_faceCount{};
+		// A point inside the polytope. Faces are oriented away from it, which keeps working
+		// when the origin is on the boundary (shapes touching).
+		glm::vec3 m_interior{};
+	};
+
+	template<class Support>
+	bool Polytope::init(const Simplex& simplex, Support&& support) {
+		m_vertexCount = 0;
+		m_faceCount = 0;
+		for (const glm::vec3& point : simplex) {
+			m_vertices[m_vertexCount++] = point;
+		}
+
+		// GJK stops early when the origin lies on a point, segment or triangle. Add support points
+		// in directions away from what we have until the simplex is a tetrahedron.
+		static const glm::vec3 axes[] = {
+			glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+			glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+		};
+		if (m_vertexCount == 1) {
+			for (const glm::vec3& axis : axes) {
+				const glm::vec3 point = support(axis);
+				if (glm::distance(point, m_vertices[0]) > EPA_TOLERANCE) {
+					m_vertices[m_vertexCount++] = point;
+					break;
+				}
+			}
+		}
+		if (m_vertexCount == 2) {
+			const glm::vec3 ab = m_vertices[1] - m_vertices[0];
+			for (const glm::vec3& axis : axes) {
+				const glm::vec3 direction = glm::cross(ab, axis);
+				if (glm::dot(direction, direction) < 1e-12f) {
+					continue;
+				}
+				const glm::vec3 point = support(direction);
+				if (glm::length(glm::cross(point - m_vertices[0], ab)) > EPA_TOLERANCE * glm::length(ab)) {
+					m_vertices[m_vertexCount++] = point;
+					break;
+				}
+			}
+		}
+		if (m_vertexCount == 3) {
+			const glm::vec3 normal = glm::normalize(glm::cross(m_vertices[1] - m_vertices[0], m_vertices[2] - m_vertices[0]));
+			for (const glm::vec3 direction : { normal, -normal }) {
+				const glm::vec3 point = support(direction);
+				if (std::abs(glm::dot(point - m_vertices[0], normal)) > EPA_TOLERANCE) {
+					m_vertices[m_vertexCount++] = point;
+					break;
+				}
+			}
+		}
+		return m_vertexCount == 4 && buildTetrahedron();
+	}
+
+	// Penetration depth and normal of two intersecting shapes, from the simplex gjk() ended with.
+	// P and Q are the same support types gjk() takes. Returns false if no contact could be found,
+	// e.g. for a degenerate (flat) Minkowski difference.
+	template<class P, class Q>
+	bool epa(const P& p, const Q& q, const Simplex& simplex, Contact& contact) {
+		auto support = [&](glm::vec3 direction) { return minkowskiSupport(p, q, direction); };
+
+		Polytope polytope;
+		if (!polytope.init(simplex, support)) {
+			return false;
+		}
+
+		size_t closest = polytope.closestFace();
+		for (unsigned int i = 0; i < EPA_MAX_ITERATIONS; i++) {
+			const Polytope::Face& face = polytope.getFace(closest);
+			const glm::vec3 point = support(face.normal);
+			if (glm::dot(point, face.normal) - face.distance < EPA_TOLERANCE || !polytope.expand(point)) {
+				break;
+			}
+			if (polytope.getFaceCount() == 0) {
+				return false;
+			}
+			closest = polytope.closestFace();
+		}
+
+		const Polytope::Face& face = polytope.getFace(closest);
+		contact.Normal = face.normal;
+		contact.Depth = std::max(face.distance, 0.0f);
+		contact.PointA = p.support(face.normal);
+		contact.PointB = q.support(-face.normal);
+		return true;
+	}
+}
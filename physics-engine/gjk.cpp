@@ -16,7 +16,12 @@ bool Line(Physics::Simplex& simplex, glm::vec3& direction) {
 	glm::vec3 ao = -a;		// A to the origin.
 
 	if (Physics::sameDirection(ab, ao)) {
-		direction = glm::cross(glm::cross(ab, ao), ab);
+		// The origin is on the segment, the search direction would be meaningless.
+		const glm::vec3 abxao = glm::cross(ab, ao);
+		if (glm::dot(abxao, abxao) <= 1e-10f * glm::dot(ab, ab) * glm::dot(ao, ao)) {
+			return true;
+		}
+		direction = glm::cross(abxao, ab);
 	} else {
 		simplex = { a };
 		// If not in the same direction, just point in to the origin.
@@ -101,22 +106,3 @@ bool Physics::nearestSimplex(Simplex& simplex, glm::vec3& direction) {
 
 	return false;
 }
-
-bool Physics::gjk(Collider* p, Collider* q, glm::vec3 initial_axis) {
-	glm::vec3 A = p->support(initial_axis) - q->support(initial_axis);
-	Simplex simplex;
-	simplex.pushFront(A);
-	glm::vec3 newDir = -A;
-
-	while (true) {
-		A = p->support(newDir) - q->support(newDir);
-		if (glm::dot(A, newDir) < 0) {
-			return false;
-		}
-		simplex.pushFront(A);
-		if (nearestSimplex(simplex, newDir)) {
-			return true;
-		}
-	}
-}
-
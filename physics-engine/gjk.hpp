@@ -32,35 +32,40 @@ namespace Physics {
 		auto end() const { return points.end() - (4 - size); }
 	};
 
-	class Collider {
-	private:
-		BoundingBox m_region;
-	public:
-		const BoundingBox& getRegion() const {
-			return m_region;
-		}
-		virtual glm::vec3 support(glm::vec3 direction) const = 0;
-	};
+	bool sameDirection(const glm::vec3& direction, const glm::vec3& ao);
+	bool nearestSimplex(Simplex& simplex, glm::vec3& direction);
 
-	class MeshCollider : public Collider {
-	private:
-		std::vector<glm::vec3> vertices;
-	public:
-		glm::vec3 support(glm::vec3 direction) const override {
-			float dot = -FLT_MAX, temp = 0.0f;
-			glm::vec3 support = glm::vec3(0.0f);
-			for (const auto& vertex : vertices) {
-				float temp = glm::dot(vertex, direction);
-				if (temp > dot) {
-					support = vertex;
-					dot = temp;
-				}
-			}
+	// Gives up on pairs that do not converge, e.g. shapes just touching.
+	constexpr unsigned int GJK_MAX_ITERATIONS = 64;
 
-			return support;
+	// Support point of the Minkowski difference p - q.
+	template<class P, class Q>
+	glm::vec3 minkowskiSupport(const P& p, const Q& q, glm::vec3 direction) {
+		return p.support(direction) - q.support(-direction);
+	}
+
+	// P and Q are any types with a glm::vec3 support(glm::vec3) member, so the support calls inline.
+	// On a hit the simplex encloses the origin (it may be flat if the shapes only touch).
+	template<class P, class Q>
+	bool gjk(const P& p, const Q& q, Simplex& simplex, glm::vec3 initialAxis = glm::vec3(1.0f, 0.0f, 0.0f)) {
+		glm::vec3 A = minkowskiSupport(p, q, initialAxis);
+		simplex = { A };
+		glm::vec3 newDir = -A;
+
+		for (unsigned int i = 0; i < GJK_MAX_ITERATIONS; i++) {
+			// The origin lies on the simplex
+			if (newDir == glm::vec3(0.0f)) {
+				return true;
+			}
+			A = minkowskiSupport(p, q, newDir);
+			if (glm::dot(A, newDir) < 0) {
+				return false;
+			}
+			simplex.pushFront(A);
+			if (nearestSimplex(simplex, newDir)) {
+				return true;
+			}
 		}
-	};
-	bool sameDirection(const glm::vec3& direction, const glm::vec3& ao);
-	bool gjk(Collider* p, Collider* q, glm::vec3 inital_axis = glm::vec3(0.0f));
-	bool nearestSimplex(Simplex& simplex, glm::vec3& direction);
+		return false;
+	}
 }
\ No newline at end of file
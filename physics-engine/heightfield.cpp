@@ -0,0 +1,127 @@
+#include "heightfield.hpp"
+#include <cfloat>
+
+using namespace Physics;
+
+BoundingBox HeightFieldData::bounds() const {
+	return BoundingBox(glm::vec3(0.0f, MinHeight, 0.0f), glm::vec3((Columns - 1) * CellSize, MaxHeight, (Rows - 1) * CellSize));
+}
+
+// Cell (i, j) spans [i, i + 1] * CellSize along x and [j, j + 1] * CellSize along z.
+bool HeightFieldData::cells(glm::vec2 min, glm::vec2 max, glm::uvec2& first, glm::uvec2& last) const {
+	const glm::vec2 size = glm::vec2((Columns - 1) * CellSize, (Rows - 1) * CellSize);
+	if (Columns < 2 || Rows < 2 || max.x < 0.0f || max.y < 0.0f || min.x > size.x || min.y > size.y) {
+		return false;
+	}
+	const glm::vec2 lo = glm::floor(glm::max(min, glm::vec2(0.0f)) / CellSize);
+	const glm::vec2 hi = glm::floor(glm::min(max, size) / CellSize);
+	first = glm::uvec2(lo);
+	last = glm::min(glm::uvec2(hi), glm::uvec2(Columns - 2, Rows - 2));
+	return true;
+}
+
+void HeightFieldData::triangle(uint32_t i, uint32_t j, uint32_t index, glm::vec3 (&vertices)[3]) const {
+	vertices[0] = vertex(i, j);
+	vertices[1] = index == 0 ? vertex(i + 1, j + 1) : vertex(i, j + 1);
+	vertices[2] = index == 0 ? vertex(i + 1, j) : vertex(i + 1, j + 1);
+}
+
+namespace {
+	// Moller-Trumbore, from either side.
+	bool rayTriangle(glm::vec3 origin, glm::vec3 direction, const glm::vec3 (&v)[3], float& t) {
+		const glm::vec3 e1 = v[1] - v[0];
+		const glm::vec3 e2 = v[2] - v[0];
+		const glm::vec3 p = glm::cross(direction, e2);
+		const float determinant = glm::dot(e1, p);
+		if (std::fabs(determinant) < 1e-12f) {
+			return false;
+		}
+		const float inverse = 1.0f / determinant;
+		const glm::vec3 s = origin - v[0];
+		const float u = glm::dot(s, p) * inverse;
+		if (u < 0.0f || u > 1.0f) {
+			return false;
+		}
+		const glm::vec3 q = glm::cross(s, e1);
+		const float w = glm::dot(direction, q) * inverse;
+		if (w < 0.0f || u + w > 1.0f) {
+			return false;
+		}
+		t = glm::dot(e2, q) * inverse;
+		return true;
+	}
+}
+
+// Clips the ray to the bounds, then walks the cells it crosses in the xz plane (a 2D DDA),
+// testing the two triangles of each.
+bool HeightFieldData::raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, float& t, glm::vec3& normal) const {
+	if (Columns < 2 || Rows < 2) {
+		return false;
+	}
+	const BoundingBox box = bounds();
+	float enter = 0.0f;
+	float exit = maxDistance;
+	for (int axis = 0; axis < 3; axis++) {
+		if (std::fabs(direction[axis]) < 1e-12f) {
+			if (origin[axis] < box.min[axis] || origin[axis] > box.max[axis]) {
+				return false;
+			}
+			continue;
+		}
+		float t1 = (box.min[axis] - origin[axis]) / direction[axis];
+		float t2 = (box.max[axis] - origin[axis]) / direction[axis];
+		if (t1 > t2) {
+			std::swap(t1, t2);
+		}
+		enter = std::max(enter, t1);
+		exit = std::min(exit, t2);
+	}
+	if (enter > exit) {
+		return false;
+	}
+
+	const glm::vec3 start = origin + direction * enter;
+	int i = std::clamp(static_cast<int>(std::floor(start.x / CellSize)), 0, static_cast<int>(Columns) - 2);
+	int j = std::clamp(static_cast<int>(std::floor(start.z / CellSize)), 0, static_cast<int>(Rows) - 2);
+	const int stepI = direction.x > 0.0f ? 1 : -1;
+	const int stepJ = direction.z > 0.0f ? 1 : -1;
+	// Distance along the ray to the next cell boundary in x and in z, and between boundaries
+	const float deltaI = direction.x != 0.0f ? CellSize / std::fabs(direction.x) : FLT_MAX;
+	const float deltaJ = direction.z != 0.0f ? CellSize / std::fabs(direction.z) : FLT_MAX;
+	float nextI = direction.x != 0.0f ? ((i + (stepI > 0 ? 1 : 0)) * CellSize - origin.x) / direction.x : FLT_MAX;
+	float nextJ = direction.z != 0.0f ? ((j + (stepJ > 0 ? 1 : 0)) * CellSize - origin.z) / direction.z : FLT_MAX;
+
+	while (true) {
+		float nearest = FLT_MAX;
+		for (uint32_t index = 0; index < 2; index++) {
+			glm::vec3 v[3];
+			triangle(i, j, index, v);
+			float hit;
+			if (rayTriangle(origin, direction, v, hit) && hit >= 0.0f && hit <= maxDistance && hit < nearest) {
+				nearest = hit;
+				normal = glm::normalize(glm::cross(v[1] - v[0], v[2] - v[0]));
+			}
+		}
+		if (nearest != FLT_MAX) {
+			t = nearest;
+			if (glm::dot(normal, direction) > 0.0f) {
+				normal = -normal;
+			}
+			return true;
+		}
+
+		if (std::min(nextI, nextJ) > exit) {
+			return false;
+		}
+		if (nextI < nextJ) {
+			i += stepI;
+			nextI += deltaI;
+		} else {
+			j += stepJ;
+			nextJ += deltaJ;
+		}
+		if (i < 0 || j < 0 || i > static_cast<int>(Columns) - 2 || j > static_cast<int>(Rows) - 2) {
+			return false;
+		}
+	}
+}
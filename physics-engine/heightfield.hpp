@@ -0,0 +1,121 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "box.hpp"
+
+namespace Physics {
+
+	// Terrain prisms reach this far below the lowest sample, so that a body pushed into the
+	// ground is pushed back out instead of falling through.
+	constexpr float HEIGHTFIELD_DEPTH = 2.0f;
+
+	// Heights sampled on a regular grid over the xz plane. Sample (i, j) is at
+	// (i * CellSize, height(i, j), j * CellSize) relative to the terrain's position. Each cell is
+	// split into two triangles along its diagonal from sample (i, j) to (i + 1, j + 1). Built once
+	// and shared by the terrain mesh and the colliders of terrain bodies.
+	struct HeightFieldData {
+		// Samples along x and along z, at least 2 each.
+		uint32_t Columns = 0;
+		uint32_t Rows = 0;
+		float CellSize = 1.0f;
+		// Row major, Rows * Columns.
+		std::vector<float> Heights{};
+		float MinHeight = 0.0f;
+		float MaxHeight = 0.0f;
+
+		float height(uint32_t i, uint32_t j) const { return Heights[j * Columns + i]; }
+		glm::vec3 vertex(uint32_t i, uint32_t j) const { return glm::vec3(i * CellSize, height(i, j), j * CellSize); }
+		BoundingBox bounds() const;
+
+		// The cells overlapping the xz rectangle [min, max] in local space, clamped to the grid.
+		// Returns false if there are none.
+		bool cells(glm::vec2 min, glm::vec2 max, glm::uvec2& first, glm::uvec2& last) const;
+		// Triangle 0 or 1 of cell (i, j). Its vertices wind so that the face normal points up.
+		void triangle(uint32_t i, uint32_t j, uint32_t index, glm::vec3 (&vertices)[3]) const;
+
+		// Nearest hit of a ray with the surface, from above or below, in local space. Only the cells
+		// the ray crosses are tested, walked in order, so the first hit found is the nearest.
+		// direction must be normalized.
+		bool raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, float& t, glm::vec3& normal) const;
+	};
+
+	// Samples height(x, z) on a columns x rows grid with cells of cellSize, from the origin.
+	template<class Sampler>
+	HeightFieldData buildHeightField(uint32_t columns, uint32_t rows, float cellSize, Sampler&& height) {
+		HeightFieldData data{ .Columns = columns, .Rows = rows, .CellSize = cellSize };
+		data.Heights.resize(static_cast<size_t>(columns) * rows);
+		for (uint32_t j = 0; j < rows; j++) {
+			for (uint32_t i = 0; i < columns; i++) {
+				data.Heights[j * columns + i] = height(i * cellSize, j * cellSize);
+			}
+		}
+		const auto [min, max] = std::minmax_element(data.Heights.begin(), data.Heights.end());
+		data.MinHeight = *min;
+		data.MaxHeight = *max;
+		return data;
+	}
+
+	// The collider of a terrain body. Terrain bodies must be anchored. A heightfield is not convex,
+	// shapes are collided and swept against the triangles of the cells under them instead, each as
+	// a HeightFieldPrism.
+	struct HeightField {
+		std::shared_ptr<const HeightFieldData> Data;
+	};
+
+	// A triangle of a heightfield extruded down to HEIGHTFIELD_DEPTH below its lowest sample, in
+	// world space. Convex, so GJK can test shapes against it.
+	struct HeightFieldPrism {
+		glm::vec3 Top[3];
+		float Bottom;
+		// Face normal of the triangle, pointing up.
+		glm::vec3 Normal;
+
+		glm::vec3 support(glm::vec3 direction) const {
+			glm::vec3 best = Top[0];
+			float bestDistance = glm::dot(best, direction);
+			for (const glm::vec3& top : Top) {
+				for (const glm::vec3 point : { top, glm::vec3(top.x, Bottom, top.z) }) {
+					const float distance = glm::dot(point, direction);
+					if (distance > bestDistance) {
+						best = point;
+						bestDistance = distance;
+					}
+				}
+			}
+			return best;
+		}
+	};
+
+	// Calls callback(prism) for the triangles of the cells under the world box [min, max], for
+	// the heightfield placed at position. Cells entirely below min.y are skipped.
+	template<class Callback>
+	void forEachPrism(const HeightFieldData& data, glm::vec3 position, glm::vec3 min, glm::vec3 max, Callback&& callback) {
+		glm::uvec2 first, last;
+		if (min.y > position.y + data.MaxHeight || !data.cells(glm::vec2(min.x - position.x, min.z - position.z), glm::vec2(max.x - position.x, max.z - position.z), first, last)) {
+			return;
+		}
+		const float bottom = position.y + data.MinHeight - HEIGHTFIELD_DEPTH;
+		for (uint32_t j = first.y; j <= last.y; j++) {
+			for (uint32_t i = first.x; i <= last.x; i++) {
+				const float top = std::max({ data.height(i, j), data.height(i + 1, j), data.height(i, j + 1), data.height(i + 1, j + 1) });
+				if (position.y + top < min.y) {
+					continue;
+				}
+				for (uint32_t index = 0; index < 2; index++) {
+					HeightFieldPrism prism{};
+					data.triangle(i, j, index, prism.Top);
+					for (glm::vec3& vertex : prism.Top) {
+						vertex += position;
+					}
+					prism.Bottom = bottom;
+					prism.Normal = glm::normalize(glm::cross(prism.Top[1] - prism.Top[0], prism.Top[2] - prism.Top[0]));
+					callback(prism);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,415 @@
+#include "hull.hpp"
+#include "simd.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <unordered_map>
+
+using namespace Physics;
+
+namespace {
+	struct HullFace {
+		std::array<uint32_t, 3> v;
+		glm::vec3 normal;
+		float distance;
+		// Points in front of this face, and the furthest of them.
+		std::vector<uint32_t> outside;
+		uint32_t furthest;
+		float furthestDistance;
+		bool alive;
+		// Seen from the eye point of the current step.
+		bool visible;
+	};
+
+	uint64_t edgeKey(uint32_t a, uint32_t b) {
+		return (static_cast<uint64_t>(a) << 32) | b;
+	}
+
+	class QuickHull {
+	public:
+		QuickHull(std::span<const glm::vec3> points) : m_points(points) {}
+
+		HullMesh build(size_t maxVertices);
+	private:
+		bool initialTetrahedron(std::array<uint32_t, 4>& tetrahedron) const;
+		void addFace(uint32_t a, uint32_t b, uint32_t c, bool orient);
+		float distance(const HullFace& face, uint32_t point) const { return glm::dot(face.normal, m_points[point]) - face.distance; }
+		void assign(std::span<const uint32_t> points, size_t firstFace);
+		HullMesh extremePoints() const;
+	private:
+		std::span<const glm::vec3> m_points;
+		std::vector<HullFace> m_faces;
+		// The live face of each directed edge, the one on the other side of edge (a, b) owns (b, a).
+		std::unordered_map<uint64_t, uint32_t> m_edgeFaces;
+		glm::vec3 m_interior{};
+		float m_epsilon{};
+	};
+
+	// With orient set the face is turned to face away from the interior, otherwise it is taken to
+	// be wound counter-clockwise seen from outside already, as faces built on the horizon are.
+	void QuickHull::addFace(uint32_t a, uint32_t b, uint32_t c, bool orient) {
+		glm::vec3 normal = glm::cross(m_points[b] - m_points[a], m_points[c] - m_points[a]);
+		const float length = glm::length(normal);
+		normal = length > 0.0f ? normal / length : glm::vec3(0.0f);
+		if (orient && glm::dot(normal, m_points[a] - m_interior) < 0.0f) {
+			normal = -normal;
+			std::swap(b, c);
+		}
+		const uint32_t index = static_cast<uint32_t>(m_faces.size());
+		m_edgeFaces[edgeKey(a, b)] = index;
+		m_edgeFaces[edgeKey(b, c)] = index;
+		m_edgeFaces[edgeKey(c, a)] = index;
+		m_faces.push_back(HullFace{ { a, b, c }, normal, glm::dot(normal, m_points[a]), {}, 0, 0.0f, true, false });
+	}
+
+	// Hands each point to the first live face from firstFace on that it is in front of.
+	// Points behind every face are inside the hull.
+	void QuickHull::assign(std::span<const uint32_t> points, size_t firstFace) {
+		for (uint32_t point : points) {
+			for (size_t i = firstFace; i < m_faces.size(); i++) {
+				HullFace& face = m_faces[i];
+				if (!face.alive) {
+					continue;
+				}
+				const float ahead = distance(face, point);
+				if (ahead > m_epsilon) {
+					if (face.outside.empty() || ahead > face.furthestDistance) {
+						face.furthest = point;
+						face.furthestDistance = ahead;
+					}
+					face.outside.push_back(point);
+					break;
+				}
+			}
+		}
+	}
+
+	bool QuickHull::initialTetrahedron(std::array<uint32_t, 4>& tetrahedron) const {
+		// The two most distant of the six axis-extreme points.
+		std::array<uint32_t, 6> extremes{};
+		for (uint32_t i = 0; i < m_points.size(); i++) {
+			for (int axis = 0; axis < 3; axis++) {
+				if (m_points[i][axis] < m_points[extremes[axis * 2]][axis]) {
+					extremes[axis * 2] = i;
+				}
+				if (m_points[i][axis] > m_points[extremes[axis * 2 + 1]][axis]) {
+					extremes[axis * 2 + 1] = i;
+				}
+			}
+		}
+		float best = -1.0f;
+		for (uint32_t i : extremes) {
+			for (uint32_t j : extremes) {
+				const float distance = glm::distance(m_points[i], m_points[j]);
+				if (distance > best) {
+					best = distance;
+					tetrahedron[0] = i;
+					tetrahedron[1] = j;
+				}
+			}
+		}
+		if (best <= m_epsilon) {
+			return false;
+		}
+
+		// Furthest from the line, then furthest from the plane.
+		const glm::vec3 a = m_points[tetrahedron[0]];
+		const glm::vec3 ab = glm::normalize(m_points[tetrahedron[1]] - a);
+		best = m_epsilon;
+		for (uint32_t i = 0; i < m_points.size(); i++) {
+			const float distance = glm::length(glm::cross(m_points[i] - a, ab));
+			if (distance > best) {
+				best = distance;
+				tetrahedron[2] = i;
+			}
+		}
+		if (best <= m_epsilon) {
+			return false;
+		}
+
+		const glm::vec3 normal = glm::normalize(glm::cross(m_points[tetrahedron[1]] - a, m_points[tetrahedron[2]] - a));
+		best = m_epsilon;
+		for (uint32_t i = 0; i < m_points.size(); i++) {
+			const float distance = std::abs(glm::dot(m_points[i] - a, normal));
+			if (distance > best) {
+				best = distance;
+				tetrahedron[3] = i;
+			}
+		}
+		return best > m_epsilon;
+	}
+
+	// Fallback for flat input: the points that are extreme along each axis.
+	HullMesh QuickHull::extremePoints() const {
+		HullMesh hull{};
+		for (int axis = 0; axis < 3; axis++) {
+			auto [min, max] = std::minmax_element(m_points.begin(), m_points.end(),
+				[axis](const glm::vec3& a, const glm::vec3& b) { return a[axis] < b[axis]; });
+			for (const glm::vec3& point : { *min, *max }) {
+				if (std::find(hull.Vertices.begin(), hull.Vertices.end(), point) == hull.Vertices.end()) {
+					hull.Vertices.push_back(point);
+				}
+			}
+		}
+		return hull;
+	}
+
+	HullMesh QuickHull::build(size_t maxVertices) {
+		glm::vec3 min = glm::vec3(FLT_MAX);
+		glm::vec3 max = glm::vec3(-FLT_MAX);
+		for (const glm::vec3& point : m_points) {
+			min = glm::min(min, point);
+			max = glm::max(max, point);
+		}
+		// Tolerance relative to the size of the input.
+		m_epsilon = 1e-5f * std::max({ std::abs(min.x), std::abs(min.y), std::abs(min.z), std::abs(max.x), std::abs(max.y), std::abs(max.z), 1.0f });
+
+		std::array<uint32_t, 4> tetrahedron{};
+		if (m_points.size() < 4 || !initialTetrahedron(tetrahedron)) {
+			HullMesh hull = m_points.empty() ? HullMesh{} : extremePoints();
+			hull.Bounds = BoundingBox(min, max);
+			return hull;
+		}
+
+		m_interior = (m_points[tetrahedron[0]] + m_points[tetrahedron[1]] + m_points[tetrahedron[2]] + m_points[tetrahedron[3]]) * 0.25f;
+		addFace(tetrahedron[0], tetrahedron[1], tetrahedron[2], true);
+		addFace(tetrahedron[0], tetrahedron[3], tetrahedron[1], true);
+		addFace(tetrahedron[0], tetrahedron[2], tetrahedron[3], true);
+		addFace(tetrahedron[1], tetrahedron[3], tetrahedron[2], true);
+
+		std::vector<uint32_t> remaining;
+		remaining.reserve(m_points.size());
+		for (uint32_t i = 0; i < m_points.size(); i++) {
+			if (std::find(tetrahedron.begin(), tetrahedron.end(), i) == tetrahedron.end()) {
+				remaining.push_back(i);
+			}
+		}
+		assign(remaining, 0);
+
+		size_t vertexCount = 4;
+		std::vector<uint32_t> visible;
+		std::vector<uint64_t> horizon;
+		while (maxVertices == 0 || vertexCount < maxVertices) {
+			// Always grow towards the furthest outside point of the whole hull.
+			size_t next = m_faces.size();
+			for (size_t i = 0; i < m_faces.size(); i++) {
+				if (m_faces[i].alive && !m_faces[i].outside.empty() &&
+					(next == m_faces.size() || m_faces[i].furthestDistance > m_faces[next].furthestDistance)) {
+					next = i;
+				}
+			}
+			if (next == m_faces.size()) {
+				break;
+			}
+			const uint32_t eye = m_faces[next].furthest;
+
+			// Faces the eye point can see, flood filled over shared edges from the face it is in
+			// front of, with the same tolerance points were assigned with. The visible faces are then
+			// one patch and their border, the horizon, one loop of the edges as they have them.
+			visible.clear();
+			horizon.clear();
+			m_faces[next].visible = true;
+			visible.push_back(static_cast<uint32_t>(next));
+			for (size_t i = 0; i < visible.size(); i++) {
+				const std::array<uint32_t, 3> v = m_faces[visible[i]].v;
+				for (int e = 0; e < 3; e++) {
+					const uint32_t a = v[e];
+					const uint32_t b = v[(e + 1) % 3];
+					HullFace& neighbour = m_faces[m_edgeFaces.at(edgeKey(b, a))];
+					if (neighbour.visible) {
+						continue;
+					}
+					if (distance(neighbour, eye) > m_epsilon) {
+						neighbour.visible = true;
+						visible.push_back(m_edgeFaces.at(edgeKey(b, a)));
+					} else {
+						horizon.push_back(edgeKey(a, b));
+					}
+				}
+			}
+
+			remaining.clear();
+			for (uint32_t i : visible) {
+				for (int e = 0; e < 3; e++) {
+					m_edgeFaces.erase(edgeKey(m_faces[i].v[e], m_faces[i].v[(e + 1) % 3]));
+				}
+				m_faces[i].alive = false;
+				for (uint32_t point : m_faces[i].outside) {
+					if (point != eye) {
+						remaining.push_back(point);
+					}
+				}
+				m_faces[i].outside.clear();
+				m_faces[i].outside.shrink_to_fit();
+			}
+
+			const size_t firstNew = m_faces.size();
+			for (uint64_t edge : horizon) {
+				addFace(static_cast<uint32_t>(edge >> 32), static_cast<uint32_t>(edge & 0xFFFFFFFF), eye, false);
+			}
+			// Only the new faces can take the orphaned points, the old ones did not have them.
+			assign(remaining, firstNew);
+			vertexCount++;
+		}
+
+		// Compact the vertices still referenced by a face.
+		HullMesh hull{};
+		std::unordered_map<uint32_t, uint32_t> remap;
+		for (const HullFace& face : m_faces) {
+			if (!face.alive) {
+				continue;
+			}
+			std::array<uint32_t, 3> indices{};
+			for (int e = 0; e < 3; e++) {
+				auto [it, inserted] = remap.emplace(face.v[e], static_cast<uint32_t>(hull.Vertices.size()));
+				if (inserted) {
+					hull.Vertices.push_back(m_points[face.v[e]]);
+				}
+				indices[e] = it->second;
+			}
+			hull.Faces.push_back(indices);
+		}
+
+		min = glm::vec3(FLT_MAX);
+		max = glm::vec3(-FLT_MAX);
+		for (const glm::vec3& vertex : hull.Vertices) {
+			min = glm::min(min, vertex);
+			max = glm::max(max, vertex);
+		}
+		hull.Bounds = BoundingBox(min, max);
+		return hull;
+	}
+}
+
+HullMesh Physics::buildHull(std::span<const glm::vec3> points, size_t maxVertices) {
+	HullMesh hull = QuickHull(points).build(maxVertices);
+
+	const size_t count = hull.Vertices.size();
+	const size_t padded = (count + 7) & ~size_t(7);
+	hull.X.resize(padded);
+	hull.Y.resize(padded);
+	hull.Z.resize(padded);
+	for (size_t i = 0; i < padded; i++) {
+		const glm::vec3& vertex = hull.Vertices[i < count ? i : 0];
+		hull.X[i] = vertex.x;
+		hull.Y[i] = vertex.y;
+		hull.Z[i] = vertex.z;
+	}
+
+	// Every edge appears in two faces, once in each direction, so each face adds the edges
+	// leaving its vertices and every neighbour gets listed exactly once.
+	std::vector<std::vector<uint32_t>> neighbours(count);
+	for (const auto& face : hull.Faces) {
+		for (int e = 0; e < 3; e++) {
+			neighbours[face[e]].push_back(face[(e + 1) % 3]);
+		}
+	}
+	hull.AdjacencyOffsets.reserve(count + 1);
+	hull.AdjacencyOffsets.push_back(0);
+	for (const auto& list : neighbours) {
+		hull.Adjacency.insert(hull.Adjacency.end(), list.begin(), list.end());
+		hull.AdjacencyOffsets.push_back(static_cast<uint32_t>(hull.Adjacency.size()));
+	}
+	return hull;
+}
+
+uint32_t HullMesh::supportBruteForce(glm::vec3 direction) const {
+	const size_t count = X.size();
+	if (count == 0) {
+		return 0;
+	}
+#if defined(PHYSICS_SIMD_AVX2)
+	const __m256 dx = _mm256_set1_ps(direction.x);
+	const __m256 dy = _mm256_set1_ps(direction.y);
+	const __m256 dz = _mm256_set1_ps(direction.z);
+	const __m256 step = _mm256_set1_ps(8.0f);
+	__m256 index = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+	__m256 best = _mm256_set1_ps(-FLT_MAX);
+	__m256 bestIndex = _mm256_setzero_ps();
+	for (size_t i = 0; i < count; i += 8) {
+		const __m256 d = _mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(_mm256_loadu_ps(&X[i]), dx),
+			_mm256_mul_ps(_mm256_loadu_ps(&Y[i]), dy)),
+			_mm256_mul_ps(_mm256_loadu_ps(&Z[i]), dz));
+		const __m256 greater = _mm256_cmp_ps(d, best, _CMP_GT_OQ);
+		best = _mm256_blendv_ps(best, d, greater);
+		bestIndex = _mm256_blendv_ps(bestIndex, index, greater);
+		index = _mm256_add_ps(index, step);
+	}
+	alignas(32) float bests[8];
+	alignas(32) float indices[8];
+	_mm256_store_ps(bests, best);
+	_mm256_store_ps(indices, bestIndex);
+	const int lanes = 8;
+#elif defined(PHYSICS_SIMD_SSE2)
+	const __m128 dx = _mm_set1_ps(direction.x);
+	const __m128 dy = _mm_set1_ps(direction.y);
+	const __m128 dz = _mm_set1_ps(direction.z);
+	const __m128 step = _mm_set1_ps(4.0f);
+	__m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	__m128 best = _mm_set1_ps(-FLT_MAX);
+	__m128 bestIndex = _mm_setzero_ps();
+	for (size_t i = 0; i < count; i += 4) {
+		const __m128 d = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_loadu_ps(&X[i]), dx),
+			_mm_mul_ps(_mm_loadu_ps(&Y[i]), dy)),
+			_mm_mul_ps(_mm_loadu_ps(&Z[i]), dz));
+		const __m128 greater = _mm_cmpgt_ps(d, best);
+		best = _mm_or_ps(_mm_and_ps(greater, d), _mm_andnot_ps(greater, best));
+		bestIndex = _mm_or_ps(_mm_and_ps(greater, index), _mm_andnot_ps(greater, bestIndex));
+		index = _mm_add_ps(index, step);
+	}
+	alignas(16) float bests[4];
+	alignas(16) float indices[4];
+	_mm_store_ps(bests, best);
+	_mm_store_ps(indices, bestIndex);
+	const int lanes = 4;
+#else
+	float bests[1] = { -FLT_MAX };
+	float indices[1] = { 0.0f };
+	for (size_t i = 0; i < count; i++) {
+		const float d = X[i] * direction.x + Y[i] * direction.y + Z[i] * direction.z;
+		if (d > bests[0]) {
+			bests[0] = d;
+			indices[0] = static_cast<float>(i);
+		}
+	}
+	const int lanes = 1;
+#endif
+	int lane = 0;
+	for (int i = 1; i < lanes; i++) {
+		if (bests[i] > bests[lane]) {
+			lane = i;
+		}
+	}
+	return static_cast<uint32_t>(indices[lane]);
+}
+
+uint32_t HullMesh::supportHillClimb(glm::vec3 direction, uint32_t start) const {
+	// On a convex hull a vertex with no better neighbour is the furthest overall.
+	uint32_t current = start < Vertices.size() ? start : 0;
+	float best = glm::dot(Vertices[current], direction);
+	while (true) {
+		uint32_t next = current;
+		for (uint32_t i = AdjacencyOffsets[current]; i < AdjacencyOffsets[current + 1]; i++) {
+			const uint32_t neighbour = Adjacency[i];
+			const float d = glm::dot(Vertices[neighbour], direction);
+			if (d > best) {
+				best = d;
+				next = neighbour;
+			}
+		}
+		if (next == current) {
+			return current;
+		}
+		current = next;
+	}
+}
+
+HullMesh Physics::buildHull(Geometry::Geometry3D& geometry, size_t maxVertices) {
+	std::vector<glm::vec3> points;
+	points.reserve(geometry.getVertexCount());
+	for (const Geometry::vertex& vertex : geometry.getVertices()) {
+		points.push_back(vertex.position);
+	}
+	return buildHull(points, maxVertices);
+}
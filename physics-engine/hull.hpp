@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "box.hpp"
+#include "geometry.hpp"
+
+namespace Physics {
+
+	// Default vertex budget for hulls built from render geometry.
+	constexpr size_t HULL_DEFAULT_MAX_VERTICES = 64;
+
+	// Above this many vertices support queries hill-climb over the vertex adjacency instead of
+	// testing every vertex.
+	constexpr size_t HULL_HILL_CLIMB_MIN_VERTICES = 32;
+
+	// A convex hull as a triangle mesh. Faces wind counter-clockwise seen from outside.
+	struct HullMesh {
+		std::vector<glm::vec3> Vertices;
+		std::vector<std::array<uint32_t, 3>> Faces;
+		BoundingBox Bounds;
+
+		// The vertices again as separate x, y and z arrays, padded to a multiple of 8 with copies of
+		// the first vertex, for the SIMD brute-force search.
+		std::vector<float> X, Y, Z;
+		// Neighbours of vertex i are Adjacency[AdjacencyOffsets[i], AdjacencyOffsets[i + 1]).
+		std::vector<uint32_t> AdjacencyOffsets;
+		std::vector<uint32_t> Adjacency;
+
+		// Index of the vertex furthest in a direction, testing every vertex.
+		uint32_t supportBruteForce(glm::vec3 direction) const;
+		// Same, walking from vertex start to the neighbour furthest in the direction until no
+		// neighbour is further. The walk is short when start is the answer of a similar query.
+		uint32_t supportHillClimb(glm::vec3 direction, uint32_t start) const;
+		bool canHillClimb() const { return Vertices.size() > HULL_HILL_CLIMB_MIN_VERTICES && !Adjacency.empty(); }
+	};
+
+	// Builds the convex hull of a point cloud with quickhull. The furthest outside point is always
+	// added first, so stopping after maxVertices points (0 for no limit) gives a simplified hull
+	// that keeps the most prominent features of the shape. Flat or degenerate input gives a hull
+	// with vertices but no faces, which is still usable for support queries.
+	HullMesh buildHull(std::span<const glm::vec3> points, size_t maxVertices = 0);
+	HullMesh buildHull(Geometry::Geometry3D& geometry, size_t maxVertices = 0);
+}
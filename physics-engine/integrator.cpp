@@ -0,0 +1,115 @@
+#include "integrator.hpp"
+#include "simd.hpp"
+#include <algorithm>
+#include <execution>
+#include <numeric>
+
+using namespace Physics;
+
+namespace {
+	using namespace Physics::Simd;
+
+	constexpr size_t LANES = width<FloatN>;
+
+	template<class V>
+	void integrateVelocityLanes(float* vx, float* vy, float* vz, float* fx, float* fy, float* fz, const float* inverseMass, const float* timeScale, glm::vec3 gravity, float deltaTime) {
+		const V step = load<V>(inverseMass) * (splat<V>(deltaTime) * load<V>(timeScale));
+		store(vx, load<V>(vx) + (load<V>(fx) + splat<V>(gravity.x)) * step);
+		store(vy, load<V>(vy) + (load<V>(fy) + splat<V>(gravity.y)) * step);
+		store(vz, load<V>(vz) + (load<V>(fz) + splat<V>(gravity.z)) * step);
+		store(fx, splat<V>(0.0f));
+		store(fy, splat<V>(0.0f));
+		store(fz, splat<V>(0.0f));
+	}
+
+	// m* hold the pseudo velocity on the way in and the motion on the way out.
+	template<class V>
+	void integratePositionLanes(float* px, float* py, float* pz, const float* vx, const float* vy, const float* vz, float* mx, float* my, float* mz, const float* timeScale, const float* sweepSquared, float* swept, float deltaTime) {
+		const V dt = splat<V>(deltaTime);
+		const V scale = load<V>(timeScale);
+		const V x = (load<V>(vx) * scale + load<V>(mx)) * dt;
+		const V y = (load<V>(vy) * scale + load<V>(my)) * dt;
+		const V z = (load<V>(vz) * scale + load<V>(mz)) * dt;
+		const V sweep = x * x + y * y + z * z > load<V>(sweepSquared);
+		const V zero = splat<V>(0.0f);
+		store(px, load<V>(px) + select(sweep, zero, x));
+		store(py, load<V>(py) + select(sweep, zero, y));
+		store(pz, load<V>(pz) + select(sweep, zero, z));
+		store(mx, x);
+		store(my, y);
+		store(mz, z);
+		store(swept, maskToFloat(sweep));
+	}
+}
+
+void Integrator::resize(size_t count) {
+	m_count = count;
+	const size_t padded = (count + LANES - 1) / LANES * LANES;
+	for (std::vector<float>* array : { &m_positionX, &m_positionY, &m_positionZ, &m_velocityX, &m_velocityY, &m_velocityZ,
+		&m_forceX, &m_forceY, &m_forceZ, &m_inverseMass, &m_timeScale, &m_sweepSquared, &m_motionX, &m_motionY, &m_motionZ, &m_swept }) {
+		array->assign(padded, 0.0f);
+	}
+}
+
+void Integrator::set(size_t body, glm::vec3 position, glm::vec3 velocity, glm::vec3 force, float inverseMass, float sweepDistance, float timeScale) {
+	m_positionX[body] = position.x;
+	m_positionY[body] = position.y;
+	m_positionZ[body] = position.z;
+	m_velocityX[body] = velocity.x;
+	m_velocityY[body] = velocity.y;
+	m_velocityZ[body] = velocity.z;
+	m_forceX[body] = force.x;
+	m_forceY[body] = force.y;
+	m_forceZ[body] = force.z;
+	m_inverseMass[body] = inverseMass;
+	m_timeScale[body] = timeScale;
+	m_sweepSquared[body] = sweepDistance < 0.0f ? -1.0f : sweepDistance * sweepDistance;
+}
+
+void Integrator::setVelocity(size_t body, glm::vec3 velocity, glm::vec3 pseudoVelocity) {
+	m_velocityX[body] = velocity.x;
+	m_velocityY[body] = velocity.y;
+	m_velocityZ[body] = velocity.z;
+	m_motionX[body] = pseudoVelocity.x;
+	m_motionY[body] = pseudoVelocity.y;
+	m_motionZ[body] = pseudoVelocity.z;
+}
+
+// Calls kernel(first, last) over the padded arrays, in chunks of INTEGRATOR_PARALLEL_BODIES in
+// parallel once there are enough bodies. The chunk size is a multiple of the SIMD width.
+template<class Kernel>
+void Integrator::forEachChunk(Kernel&& kernel) {
+	static_assert(INTEGRATOR_PARALLEL_BODIES % LANES == 0);
+	const size_t padded = m_inverseMass.size();
+	if (padded < INTEGRATOR_PARALLEL_BODIES) {
+		kernel(size_t{ 0 }, padded);
+		return;
+	}
+	const size_t chunks = (padded + INTEGRATOR_PARALLEL_BODIES - 1) / INTEGRATOR_PARALLEL_BODIES;
+	if (m_sequence.size() < chunks) {
+		m_sequence.resize(chunks);
+		std::iota(m_sequence.begin(), m_sequence.end(), 0);
+	}
+	std::for_each(std::execution::par, m_sequence.begin(), m_sequence.begin() + chunks, [&](uint32_t chunk) {
+		const size_t first = chunk * INTEGRATOR_PARALLEL_BODIES;
+		kernel(first, std::min(first + INTEGRATOR_PARALLEL_BODIES, padded));
+	});
+}
+
+void Integrator::integrateVelocities(glm::vec3 gravity, float deltaTime) {
+	forEachChunk([&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i += LANES) {
+			integrateVelocityLanes<FloatN>(&m_velocityX[i], &m_velocityY[i], &m_velocityZ[i], &m_forceX[i], &m_forceY[i], &m_forceZ[i],
+				&m_inverseMass[i], &m_timeScale[i], gravity, deltaTime);
+		}
+	});
+}
+
+void Integrator::integratePositions(float deltaTime) {
+	forEachChunk([&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i += LANES) {
+			integratePositionLanes<FloatN>(&m_positionX[i], &m_positionY[i], &m_positionZ[i], &m_velocityX[i], &m_velocityY[i], &m_velocityZ[i],
+				&m_motionX[i], &m_motionY[i], &m_motionZ[i], &m_timeScale[i], &m_sweepSquared[i], &m_swept[i], deltaTime);
+		}
+	});
+}
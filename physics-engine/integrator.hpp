@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Physics {
+
+	// Bodies below this height have fallen out of the world and are removed.
+	constexpr float WORLD_KILL_Y = -100.0f;
+
+	// Steps with at least this many bodies integrate in parallel, INTEGRATOR_PARALLEL_BODIES per task.
+	constexpr size_t INTEGRATOR_PARALLEL_BODIES = 16384;
+
+	// The moving bodies of a step, structure-of-arrays, so that integrating them is a straight pass
+	// over each array in SIMD registers. The bodies are copied in from their components at the
+	// start of a step and back out at the end, in between they are only touched through here.
+	// Arrays are padded to the SIMD width with bodies that have no mass and never move.
+	class Integrator {
+	public:
+		// Makes room for count bodies, dropping the previous step's.
+		void resize(size_t count);
+		size_t size() const { return m_count; }
+
+		// sweepDistance: bodies moving further than this are swept instead of moved, a negative
+		// distance sweeps any motion. timeScale: the body steps over timeScale * deltaTime, for
+		// bodies that are not stepped every tick (see lod.hpp).
+		void set(size_t body, glm::vec3 position, glm::vec3 velocity, glm::vec3 force, float inverseMass, float sweepDistance, float timeScale);
+
+		// velocity += (force + gravity) * inverse mass * deltaTime * time scale, then the forces are cleared.
+		void integrateVelocities(glm::vec3 gravity, float deltaTime);
+		// The velocity after the contacts, and the pseudo velocity that only moves the body this step.
+		void setVelocity(size_t body, glm::vec3 velocity, glm::vec3 pseudoVelocity);
+		// motion = (velocity * time scale + pseudo velocity) * deltaTime. The pseudo velocity removes
+		// penetration over a single tick whatever the body's time scale. Bodies moving further than
+		// their sweep distance keep their position, the others are moved by their motion.
+		void integratePositions(float deltaTime);
+
+		glm::vec3 getPosition(size_t body) const { return glm::vec3(m_positionX[body], m_positionY[body], m_positionZ[body]); }
+		glm::vec3 getVelocity(size_t body) const { return glm::vec3(m_velocityX[body], m_velocityY[body], m_velocityZ[body]); }
+		// The motion of the last integratePositions.
+		glm::vec3 getMotion(size_t body) const { return glm::vec3(m_motionX[body], m_motionY[body], m_motionZ[body]); }
+		bool isSwept(size_t body) const { return m_swept[body] != 0.0f; }
+	private:
+		template<class Kernel>
+		void forEachChunk(Kernel&& kernel);
+	private:
+		size_t m_count = 0;
+
+		std::vector<float> m_positionX{};
+		std::vector<float> m_positionY{};
+		std::vector<float> m_positionZ{};
+		std::vector<float> m_velocityX{};
+		std::vector<float> m_velocityY{};
+		std::vector<float> m_velocityZ{};
+		std::vector<float> m_forceX{};
+		std::vector<float> m_forceY{};
+		std::vector<float> m_forceZ{};
+		std::vector<float> m_inverseMass{};
+		std::vector<float> m_timeScale{};
+		// Squared sweep distance, or -1.
+		std::vector<float> m_sweepSquared{};
+		// Pseudo velocity in, motion out.
+		std::vector<float> m_motionX{};
+		std::vector<float> m_motionY{};
+		std::vector<float> m_motionZ{};
+		// 1 for swept bodies, 0 for the others.
+		std::vector<float> m_swept{};
+		// 0, 1, 2, ... for the parallel loops.
+		std::vector<uint32_t> m_sequence{};
+	};
+}
@@ -0,0 +1,52 @@
+#include "interpolation.hpp"
+
+using namespace Physics;
+
+void InterpolationBuffer::advance() {
+	for (InterpolatedBody& body : m_frame.Bodies) {
+		body.Previous = body.Current;
+	}
+}
+
+// The entity's body, added if it has none yet.
+uint32_t InterpolationBuffer::slot(Entity entity) {
+	uint32_t& slot = m_slots[entity];
+	if (slot == NO_SLOT) {
+		slot = static_cast<uint32_t>(m_frame.Bodies.size());
+		m_frame.Bodies.push_back(InterpolatedBody{});
+		m_frame.Entities.push_back(entity);
+	}
+	return slot;
+}
+
+void InterpolationBuffer::record(Entity entity, glm::vec3 position, bool overlapping, float boxScale) {
+	const bool added = m_slots[entity] == NO_SLOT;
+	InterpolatedBody& body = m_frame.Bodies[slot(entity)];
+	if (added) {
+		body.Previous = position;
+	}
+	body.Current = position;
+	body.Overlapping = overlapping;
+	body.BoxScale = boxScale;
+}
+
+void InterpolationBuffer::place(Entity entity, glm::vec3 position, float boxScale) {
+	InterpolatedBody& body = m_frame.Bodies[slot(entity)];
+	body.Previous = position;
+	body.Current = position;
+	body.BoxScale = boxScale;
+}
+
+// The last body takes the place of the removed one.
+void InterpolationBuffer::remove(Entity entity) {
+	const uint32_t slot = m_slots[entity];
+	if (slot == NO_SLOT) {
+		return;
+	}
+	m_frame.Bodies[slot] = m_frame.Bodies.back();
+	m_frame.Entities[slot] = m_frame.Entities.back();
+	m_slots[m_frame.Entities[slot]] = slot;
+	m_frame.Bodies.pop_back();
+	m_frame.Entities.pop_back();
+	m_slots[entity] = NO_SLOT;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "types.hpp"
+
+namespace Physics {
+
+	// Where a body was at the last two physics steps, and what else drawing it needs, so that the
+	// render thread does not read components the physics thread writes.
+	struct InterpolatedBody {
+		glm::vec3 Previous;
+		glm::vec3 Current;
+		bool Overlapping;
+		// What the body's box is drawn scaled by.
+		float BoxScale;
+	};
+
+	// The bodies of the interpolation buffer, densely: body i is Entities[i], in no particular
+	// order. Copying it costs as much as there are bodies, so this is what is handed to another
+	// thread, not the buffer.
+	struct InterpolationFrame {
+		std::vector<Entity> Entities{};
+		std::vector<InterpolatedBody> Bodies{};
+	};
+
+	// Where the bodies were at the last two physics steps. Physics runs at a fixed rate below the
+	// frame rate, so a frame drawn between two steps places each body the same fraction of the way
+	// from its previous position to its current one. Bodies are stored densely, so that starting
+	// a step is a single pass over them; the slot of each entity stays with the buffer.
+	class InterpolationBuffer {
+	public:
+		InterpolationBuffer() : m_slots(MAX_ENTITIES, NO_SLOT) { }
+
+		// Starts a step: the current positions become the previous ones.
+		void advance();
+		// Where the step left the body, and whether it touches anything.
+		void record(Entity entity, glm::vec3 position, bool overlapping, float boxScale);
+		// Puts the body at position without moving it there, e.g. when it is added or teleported.
+		void place(Entity entity, glm::vec3 position, float boxScale);
+		void remove(Entity entity);
+
+		const InterpolationFrame& getFrame() const { return m_frame; }
+	private:
+		static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+		uint32_t slot(Entity entity);
+	private:
+		// Index of each entity's body in the frame, or NO_SLOT.
+		std::vector<uint32_t> m_slots;
+		InterpolationFrame m_frame{};
+	};
+}
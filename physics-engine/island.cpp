@@ -0,0 +1,34 @@
+#include "island.hpp"
+#include <numeric>
+#include <utility>
+
+using namespace Physics;
+
+void Islands::reset(size_t count) {
+	m_parent.resize(count);
+	std::iota(m_parent.begin(), m_parent.end(), 0);
+	m_size.assign(count, 1);
+}
+
+// Union by size, so the trees stay shallow.
+void Islands::join(uint32_t a, uint32_t b) {
+	a = find(a);
+	b = find(b);
+	if (a == b) {
+		return;
+	}
+	if (m_size[a] < m_size[b]) {
+		std::swap(a, b);
+	}
+	m_parent[b] = a;
+	m_size[a] += m_size[b];
+}
+
+// Path halving: every other node on the way up is pointed at its grandparent.
+uint32_t Islands::find(uint32_t a) {
+	while (m_parent[a] != a) {
+		m_parent[a] = m_parent[m_parent[a]];
+		a = m_parent[a];
+	}
+	return a;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Physics {
+
+	struct SleepSettings {
+		bool Enabled = true;
+		// A body is resting while it moves slower than this.
+		float LinearVelocity = 0.05f;
+		// An island falls asleep once all of its bodies have been resting for this many steps.
+		uint32_t Steps = 60;
+	};
+
+	// Contacts with a normal this close to straight up count as standing on something.
+	constexpr float GROUND_NORMAL_Y = 0.7f;
+
+	// Disjoint sets over the bodies of a step, joined along the contacts between moving bodies.
+	// Each set is a simulation island: bodies that can only affect each other through contacts
+	// inside the set, and that are put to sleep and woken together.
+	class Islands {
+	public:
+		// Starts over with count islands of one body each.
+		void reset(size_t count);
+		void join(uint32_t a, uint32_t b);
+		// Representative body of the island of a.
+		uint32_t find(uint32_t a);
+	private:
+		std::vector<uint32_t> m_parent{};
+		std::vector<uint32_t> m_size{};
+	};
+}
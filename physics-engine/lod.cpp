@@ -0,0 +1,93 @@
+#include "lod.hpp"
+#include <algorithm>
+#include <cfloat>
+
+using namespace Physics;
+
+void LodScheduler::begin(const LodSettings& settings, float deltaTime) {
+	m_settings = settings;
+	m_deltaTime = deltaTime;
+	m_tick++;
+	m_mid.clear();
+	m_far.clear();
+	m_kinematic.clear();
+}
+
+LodTier LodScheduler::add(Entity entity, glm::vec3 position) {
+	if (!m_settings.Enabled || (!m_viewer && m_pointsOfInterest.empty())) {
+		m_tiers[entity] = LodTier::Near;
+		m_elapsed[entity] = 0.0f;
+		m_timeScales[entity] = 1.0f;
+		m_stepped[entity] = m_tick;
+		return LodTier::Near;
+	}
+
+	float nearest = FLT_MAX;
+	if (m_viewer) {
+		const glm::vec3 d = position - *m_viewer;
+		nearest = glm::dot(d, d);
+	}
+	for (const glm::vec3& point : m_pointsOfInterest) {
+		const glm::vec3 d = position - point;
+		nearest = std::min(nearest, glm::dot(d, d));
+	}
+
+	m_elapsed[entity] += m_deltaTime;
+	if (nearest < m_settings.NearDistance * m_settings.NearDistance) {
+		m_tiers[entity] = LodTier::Near;
+		step(entity);
+	} else if (nearest < m_settings.FarDistance * m_settings.FarDistance) {
+		m_tiers[entity] = LodTier::Mid;
+		m_mid.push_back(entity);
+	} else {
+		m_tiers[entity] = LodTier::Far;
+		m_far.push_back(entity);
+	}
+	return m_tiers[entity];
+}
+
+void LodScheduler::promote(Entity entity) {
+	if (m_tiers[entity] == LodTier::Near) {
+		return;
+	}
+	m_tiers[entity] = LodTier::Near;
+	step(entity);
+}
+
+void LodScheduler::step(Entity entity) {
+	m_timeScales[entity] = std::min(m_elapsed[entity], m_settings.MaxTimeStep) / m_deltaTime;
+	m_elapsed[entity] = 0.0f;
+	m_stepped[entity] = m_tick;
+}
+
+void LodScheduler::pick(std::vector<Entity>& bodies) {
+	for (Entity entity : m_far) {
+		if (m_tiers[entity] != LodTier::Far) {
+			continue;
+		}
+		m_elapsed[entity] = 0.0f;
+		if (m_settings.Far == FarMode::Kinematic) {
+			m_kinematic.push_back(entity);
+		}
+	}
+
+	if (m_mid.empty()) {
+		return;
+	}
+	const size_t interval = std::max<uint32_t>(m_settings.MidInterval, 1);
+	const size_t turns = std::min<size_t>((m_mid.size() + interval - 1) / interval, m_settings.MidBudget);
+	// Bodies were added in entity order, the turn goes on from the first one at or after the cursor
+	const size_t first = std::lower_bound(m_mid.begin(), m_mid.end(), m_cursor) - m_mid.begin();
+	size_t taken = 0;
+	for (size_t i = 0; i < m_mid.size() && taken < turns; i++) {
+		const Entity entity = m_mid[(first + i) % m_mid.size()];
+		m_cursor = entity + 1;
+		// Promoted bodies already step
+		if (m_tiers[entity] != LodTier::Mid) {
+			continue;
+		}
+		step(entity);
+		bodies.push_back(entity);
+		taken++;
+	}
+}
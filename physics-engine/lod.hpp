@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <glm/glm.hpp>
+#include "types.hpp"
+
+namespace Physics {
+
+	// How often a body is simulated, from its distance to the viewer or the nearest point of interest.
+	enum class LodTier : uint8_t {
+		// Stepped every tick.
+		Near,
+		// Stepped about every LodSettings::MidInterval ticks, over the time since its last step.
+		Mid,
+		// Frozen or moved along its velocity, see FarMode.
+		Far
+	};
+
+	enum class FarMode : uint8_t {
+		// Far bodies stand still, their time is dropped.
+		Freeze,
+		// Far bodies keep moving along their velocity, without forces or collisions.
+		Kinematic
+	};
+
+	struct LodSettings {
+		// Off, every body is near.
+		bool Enabled = false;
+		// Bodies closer than NearDistance are near, closer than FarDistance mid-range, the rest far.
+		float NearDistance = 40.0f;
+		float FarDistance = 120.0f;
+		// Mid-range bodies are stepped in turns, a 1 / MidInterval share of them per tick, but never
+		// more than MidBudget at once. Bodies left waiting by the budget step later, over more time.
+		uint32_t MidInterval = 4;
+		uint32_t MidBudget = 2048;
+		// The most time a body steps over at once. Time it waited for beyond this is dropped.
+		float MaxTimeStep = 1.0f / 15.0f;
+		FarMode Far = FarMode::Freeze;
+	};
+
+	// Picks the bodies simulated each tick. Near bodies always are; mid-range bodies are visited
+	// round-robin in entity order from where the last tick stopped, so the work per tick stays
+	// bounded however many bodies are out there, and every one of them gets its turn. Each body
+	// steps over the time since its last step, its time scale, so mid-range bodies fall and slide
+	// as fast as near ones, only in coarser steps.
+	class LodScheduler {
+	public:
+		LodScheduler() :
+			m_tiers(MAX_ENTITIES, LodTier::Near),
+			m_elapsed(MAX_ENTITIES, 0.0f),
+			m_timeScales(MAX_ENTITIES, 1.0f),
+			m_stepped(MAX_ENTITIES, 0) { }
+
+		// Where distances are measured from: the viewer, e.g. the camera, and any points of interest.
+		// With LOD enabled and none of them set, every body is near.
+		void setViewer(glm::vec3 position) { m_viewer = position; }
+		void setPointsOfInterest(std::vector<glm::vec3> points) { m_pointsOfInterest = std::move(points); }
+
+		// Starts a tick. Then add every moving body, promote the ones that must step anyway, and
+		// pick the mid-range bodies whose turn it is.
+		void begin(const LodSettings& settings, float deltaTime);
+		// Sorts the body into its tier. Near bodies step this tick.
+		LodTier add(Entity entity, glm::vec3 position);
+		// Makes a mid-range or far body near for this tick, e.g. one touching a near body.
+		void promote(Entity entity);
+		// Appends the mid-range bodies stepping this tick to bodies, and collects the far bodies
+		// to move kinematically.
+		void pick(std::vector<Entity>& bodies);
+
+		LodTier getTier(Entity entity) const { return m_tiers[entity]; }
+		// Whether the body steps this tick. Bodies not added this tick do not.
+		bool isStepping(Entity entity) const { return m_stepped[entity] == m_tick; }
+		// Whether a mid-range or far body sits this tick out. It is then treated like a sleeping
+		// body: kept where it is, and solved as static by the bodies touching it.
+		bool isParked(Entity entity) const { return m_tiers[entity] != LodTier::Near && m_stepped[entity] != m_tick; }
+		// The time a stepping body steps over, in ticks.
+		float getTimeScale(Entity entity) const { return m_timeScales[entity]; }
+		// Far bodies to move along their velocity this tick.
+		const std::vector<Entity>& getKinematic() const { return m_kinematic; }
+	private:
+		void step(Entity entity);
+	private:
+		LodSettings m_settings{};
+		float m_deltaTime = 0.0f;
+		uint32_t m_tick = 0;
+		std::optional<glm::vec3> m_viewer{};
+		std::vector<glm::vec3> m_pointsOfInterest{};
+
+		std::vector<LodTier> m_tiers;
+		// Time since the body last stepped.
+		std::vector<float> m_elapsed;
+		std::vector<float> m_timeScales;
+		// The last tick each body stepped in.
+		std::vector<uint32_t> m_stepped;
+
+		// The mid-range and far bodies of this tick, in the order they were added.
+		std::vector<Entity> m_mid{};
+		std::vector<Entity> m_far{};
+		std::vector<Entity> m_kinematic{};
+		// The entity the next mid-range turn starts at.
+		Entity m_cursor = 0;
+	};
+}
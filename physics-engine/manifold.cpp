@@ -0,0 +1,131 @@
+#include "manifold.hpp"
+#include <algorithm>
+#include <cfloat>
+
+using namespace Physics;
+
+namespace {
+	// Picks the four points spanning the largest area: the deepest one, the one furthest from it,
+	// the one furthest from that edge, and the one adding the most area to the triangle.
+	uint32_t reduce(ContactPoint* points, uint32_t count) {
+		if (count <= MAX_MANIFOLD_POINTS) {
+			return count;
+		}
+		std::array<uint32_t, MAX_MANIFOLD_POINTS> chosen{};
+
+		for (uint32_t i = 1; i < count; i++) {
+			if (points[i].Depth > points[chosen[0]].Depth) {
+				chosen[0] = i;
+			}
+		}
+		const glm::vec3 a = points[chosen[0]].LocalA;
+
+		float best = -1.0f;
+		for (uint32_t i = 0; i < count; i++) {
+			const glm::vec3 d = points[i].LocalA - a;
+			if (glm::dot(d, d) > best) {
+				best = glm::dot(d, d);
+				chosen[1] = i;
+			}
+		}
+		const glm::vec3 b = points[chosen[1]].LocalA;
+
+		best = -1.0f;
+		for (uint32_t i = 0; i < count; i++) {
+			const float area = glm::length(glm::cross(b - a, points[i].LocalA - a));
+			if (area > best) {
+				best = area;
+				chosen[2] = i;
+			}
+		}
+		const glm::vec3 c = points[chosen[2]].LocalA;
+
+		// Area added outside each edge of the triangle
+		best = -1.0f;
+		for (uint32_t i = 0; i < count; i++) {
+			const glm::vec3 p = points[i].LocalA;
+			const float area = std::max({ glm::length(glm::cross(b - a, p - a)), glm::length(glm::cross(c - b, p - b)), glm::length(glm::cross(a - c, p - c)) });
+			if (area > best && i != chosen[0] && i != chosen[1] && i != chosen[2]) {
+				best = area;
+				chosen[3] = i;
+			}
+		}
+
+		std::array<ContactPoint, MAX_MANIFOLD_POINTS> kept{};
+		for (uint32_t i = 0; i < MAX_MANIFOLD_POINTS; i++) {
+			kept[i] = points[chosen[i]];
+		}
+		std::copy(kept.begin(), kept.end(), points);
+		return MAX_MANIFOLD_POINTS;
+	}
+}
+
+uint32_t Physics::reduceContacts(ContactPoint* points, uint32_t count) {
+	return reduce(points, count);
+}
+
+void ContactManifold::merge(const ContactManifold& fresh, glm::vec3 positionA, glm::vec3 positionB, bool accumulate) {
+	if (!accumulate) {
+		// Matched against a copy, the fresh points overwrite the old ones as they go.
+		const std::array<ContactPoint, MAX_MANIFOLD_POINTS> old = Points;
+		const uint32_t oldCount = PointCount;
+		for (uint32_t i = 0; i < fresh.PointCount; i++) {
+			ContactPoint point = fresh.Points[i];
+			for (uint32_t j = 0; j < oldCount; j++) {
+				if (old[j].Id == point.Id) {
+					point.NormalImpulse = old[j].NormalImpulse;
+					point.TangentImpulse[0] = old[j].TangentImpulse[0];
+					point.TangentImpulse[1] = old[j].TangentImpulse[1];
+					break;
+				}
+			}
+			Points[i] = point;
+		}
+		Normal = fresh.Normal;
+		PointCount = fresh.PointCount;
+		return;
+	}
+
+	// Room for the old points and the new one.
+	ContactPoint points[MAX_MANIFOLD_POINTS + 1];
+	uint32_t count = 0;
+
+	// Keep old points that are still touching and have not slid apart.
+	for (uint32_t i = 0; i < PointCount; i++) {
+		ContactPoint point = Points[i];
+		const glm::vec3 separation = (positionA + point.LocalA) - (positionB + point.LocalB);
+		point.Depth = glm::dot(separation, fresh.Normal);
+		const glm::vec3 drift = separation - fresh.Normal * point.Depth;
+		if (point.Depth >= -CONTACT_BREAK_DISTANCE && glm::dot(drift, drift) <= CONTACT_MATCH_DISTANCE * CONTACT_MATCH_DISTANCE) {
+			points[count++] = point;
+		}
+	}
+
+	// The new point replaces an old one close to it, or gets a new id.
+	for (uint32_t i = 0; i < fresh.PointCount; i++) {
+		ContactPoint point = fresh.Points[i];
+		uint32_t match = count;
+		for (uint32_t j = 0; j < count; j++) {
+			const glm::vec3 d = points[j].LocalA - point.LocalA;
+			if (glm::dot(d, d) <= CONTACT_MATCH_DISTANCE * CONTACT_MATCH_DISTANCE) {
+				match = j;
+				break;
+			}
+		}
+		if (match < count) {
+			point.Id = points[match].Id;
+			point.NormalImpulse = points[match].NormalImpulse;
+			point.TangentImpulse[0] = points[match].TangentImpulse[0];
+			point.TangentImpulse[1] = points[match].TangentImpulse[1];
+			points[match] = point;
+		} else if (count < MAX_MANIFOLD_POINTS + 1) {
+			point.Id = NextId++;
+			points[count++] = point;
+		}
+	}
+
+	count = reduce(points, count);
+	std::copy(points, points + count, Points.begin());
+	Normal = fresh.Normal;
+	PointCount = count;
+}
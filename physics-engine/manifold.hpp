@@ -0,0 +1,48 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace Physics {
+
+	constexpr uint32_t MAX_MANIFOLD_POINTS = 4;
+	// A new contact point this close to an old one is taken to be the same point.
+	constexpr float CONTACT_MATCH_DISTANCE = 0.05f;
+	// Remembered points are dropped once the bodies separate there by more than this.
+	constexpr float CONTACT_BREAK_DISTANCE = 0.02f;
+
+	struct ContactPoint {
+		// The contact on A and on B, relative to the positions of the bodies.
+		glm::vec3 LocalA = glm::vec3(0.0f);
+		glm::vec3 LocalB = glm::vec3(0.0f);
+		float Depth = 0.0f;
+		// Identifies the features (faces, edges, vertices) in contact. A point with the same id as
+		// one in the previous step is the same contact, and inherits its impulses.
+		uint32_t Id = 0;
+		// Impulses accumulated by the solver along the normal and the two tangents. They are
+		// applied again at the start of the next step (warm starting).
+		float NormalImpulse = 0.0f;
+		float TangentImpulse[2] = { 0.0f, 0.0f };
+	};
+
+	// Up to four contact points between two bodies sharing one normal, from A towards B.
+	struct ContactManifold {
+		glm::vec3 Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+		std::array<ContactPoint, MAX_MANIFOLD_POINTS> Points{};
+		uint32_t PointCount = 0;
+		// Id for the next point without features, see merge.
+		uint32_t NextId = 0;
+
+		void clear() { PointCount = 0; }
+
+		// Replaces the points with the ones found this step, carrying the impulses of points with
+		// matching ids over. With accumulate set, fresh has one point without features (from GJK
+		// and EPA); old points that still touch are then kept as well, matched by distance, and
+		// the set is reduced back to the four that span the largest area.
+		void merge(const ContactManifold& fresh, glm::vec3 positionA, glm::vec3 positionB, bool accumulate);
+	};
+
+	// Reduces more than four points to the four spanning the largest area, keeping the deepest, and
+	// moves them to the front. Returns the number of points left.
+	uint32_t reduceContacts(ContactPoint* points, uint32_t count);
+}
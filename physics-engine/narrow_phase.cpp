@@ -0,0 +1,421 @@
+#include "narrow_phase.hpp"
+#include "simd.hpp"
+
+using namespace Physics;
+
+namespace {
+	// Contact of a convex shape (A) with a heightfield (B). Every triangle under the shape that it
+	// overlaps pushes it out along the triangle's face normal, never along an edge between two
+	// triangles, so bodies slide over the seams of the grid without catching on them. The depth
+	// along the face is capped by the penetration EPA finds, or a body barely touching a steep
+	// triangle would be thrown off it. The deepest of these is the contact.
+	template<class Shape>
+	bool collideConcave(const Shape& shape, glm::vec3 position, const HeightField& field, glm::vec3 fieldPosition, Contact& contact) {
+		const Placed<Shape> placed{ shape, position };
+		const BoundingBox bounds = supportBounds(placed);
+		bool hit = false;
+		forEachPrism(*field.Data, fieldPosition, bounds.min, bounds.max, [&](const HeightFieldPrism& prism) {
+			const glm::vec3 deepest = placed.support(-prism.Normal);
+			float depth = glm::dot(prism.Normal, prism.Top[0] - deepest);
+			if (depth <= 0.0f || (hit && depth <= contact.Depth)) {
+				return;
+			}
+			const glm::vec3 axis = position - (prism.Top[0] + prism.Top[1] + prism.Top[2]) / 3.0f;
+			Simplex simplex;
+			if (!gjk(placed, prism, simplex, glm::dot(axis, axis) > 0.0f ? axis : prism.Normal)) {
+				return;
+			}
+			Contact penetration;
+			if (epa(placed, prism, simplex, penetration)) {
+				depth = std::min(depth, penetration.Depth);
+			}
+			if (hit && depth <= contact.Depth) {
+				return;
+			}
+			contact.Normal = -prism.Normal;
+			contact.Depth = depth;
+			contact.PointA = deepest;
+			contact.PointB = deepest + prism.Normal * depth;
+			hit = true;
+		});
+		return hit;
+	}
+
+	// Contact of a convex shape (A) with a level (B), pushed out of the solid the way
+	// BSPTree::penetration finds.
+	template<class Shape>
+	bool collideConcave(const Shape& shape, glm::vec3 position, const Level& level, glm::vec3 levelPosition, Contact& contact) {
+		float depth;
+		glm::vec3 normal;
+		if (!level.Tree->penetration(Placed<Shape>{ shape, position - levelPosition }, depth, normal)) {
+			return false;
+		}
+		contact.Normal = -normal;
+		contact.Depth = depth;
+		contact.PointA = position + shape.support(-normal);
+		contact.PointB = contact.PointA + normal * depth;
+		return true;
+	}
+
+	// collide for pairs with a heightfield or level on either side.
+	template<class A, class B>
+	bool collideWithConcave(const A& shapeA, glm::vec3 positionA, const B& shapeB, glm::vec3 positionB, Contact& contact) {
+		if constexpr (isConcave<A> && isConcave<B>) {
+			return false;
+		} else if constexpr (isConcave<B>) {
+			return collideConcave(shapeA, positionA, shapeB, positionB, contact);
+		} else {
+			if (!collideConcave(shapeB, positionB, shapeA, positionA, contact)) {
+				return false;
+			}
+			contact.Normal = -contact.Normal;
+			std::swap(contact.PointA, contact.PointB);
+			return true;
+		}
+	}
+}
+
+bool Physics::collide(const ColliderShape& a, glm::vec3 positionA, const ColliderShape& b, glm::vec3 positionB, Contact& contact) {
+	return std::visit([&](const auto& shapeA, const auto& shapeB) {
+		using A = std::decay_t<decltype(shapeA)>;
+		using B = std::decay_t<decltype(shapeB)>;
+		if constexpr (std::is_same_v<A, std::monostate> || std::is_same_v<B, std::monostate>) {
+			return false;
+		} else if constexpr (isConcave<A> || isConcave<B>) {
+			return collideWithConcave(shapeA, positionA, shapeB, positionB, contact);
+		} else {
+			const Placed<A> p{ shapeA, positionA };
+			const Placed<B> q{ shapeB, positionB };
+			// Start along the line between the centers, it is usually close to the separating axis.
+			const glm::vec3 axis = positionA - positionB;
+			Simplex simplex;
+			if (!gjk(p, q, simplex, glm::dot(axis, axis) > 0.0f ? axis : glm::vec3(1.0f, 0.0f, 0.0f))) {
+				return false;
+			}
+			return epa(p, q, simplex, contact);
+		}
+	}, a, b);
+}
+
+namespace {
+	using namespace Physics::Simd;
+
+	// Structure-of-arrays batch: input columns first, then the output columns every kernel writes.
+	enum Column {
+		IN_0 = 0,
+		OUT_HIT = 12, OUT_NX, OUT_NY, OUT_NZ, OUT_DEPTH, OUT_PAX, OUT_PAY, OUT_PAZ, OUT_PBX, OUT_PBY, OUT_PBZ,
+		COLUMN_COUNT
+	};
+
+	struct Columns {
+		float* data;
+		size_t stride;
+
+		float* operator[](size_t column) const { return data + column * stride; }
+	};
+
+	template<class V>
+	void storeContact(const Columns& c, size_t i, V hit, V nx, V ny, V nz, V depth, V pax, V pay, V paz, V pbx, V pby, V pbz) {
+		store(c[OUT_HIT] + i, maskToFloat(hit));
+		store(c[OUT_NX] + i, nx);
+		store(c[OUT_NY] + i, ny);
+		store(c[OUT_NZ] + i, nz);
+		store(c[OUT_DEPTH] + i, depth);
+		store(c[OUT_PAX] + i, pax);
+		store(c[OUT_PAY] + i, pay);
+		store(c[OUT_PAZ] + i, paz);
+		store(c[OUT_PBX] + i, pbx);
+		store(c[OUT_PBY] + i, pby);
+		store(c[OUT_PBZ] + i, pbz);
+	}
+
+	// Unit vector along the axis where the penetration e is smallest, pointing along s (+-1).
+	template<class V, class M = decltype(std::declval<V>() < std::declval<V>())>
+	void minAxis(V ex, V ey, V ez, V sx, V sy, V sz, V& nx, V& ny, V& nz, V& e) {
+		const V zero = splat<V>(0.0f);
+		const M useZ = (ez < ex) & (ez < ey);
+		const M useY = (ey < ex) & (ey <= ez);
+		nx = select(useY | useZ, zero, sx);
+		ny = select(useY, sy, zero);
+		nz = select(useZ, sz, zero);
+		e = min(ex, min(ey, ez));
+	}
+
+	// Inputs: center and radius of A, center and radius of B.
+	struct SphereSphereKernel {
+		template<class V>
+		static void run(const Columns& c, size_t i) {
+			const V ax = load<V>(c[0] + i), ay = load<V>(c[1] + i), az = load<V>(c[2] + i), ar = load<V>(c[3] + i);
+			const V bx = load<V>(c[4] + i), by = load<V>(c[5] + i), bz = load<V>(c[6] + i), br = load<V>(c[7] + i);
+			const V zero = splat<V>(0.0f);
+
+			const V dx = bx - ax, dy = by - ay, dz = bz - az;
+			const V distanceSquared = dx * dx + dy * dy + dz * dz;
+			const V radius = ar + br;
+			const auto hit = distanceSquared <= radius * radius;
+
+			// Concentric spheres get an arbitrary normal, straight up.
+			const V distance = sqrt(distanceSquared);
+			const auto apart = distance > splat<V>(1e-6f);
+			const V inverse = select(apart, splat<V>(1.0f) / distance, zero);
+			const V nx = select(apart, dx * inverse, zero);
+			const V ny = select(apart, dy * inverse, splat<V>(1.0f));
+			const V nz = select(apart, dz * inverse, zero);
+
+			storeContact<V>(c, i, hit, nx, ny, nz, radius - distance,
+				ax + nx * ar, ay + ny * ar, az + nz * ar,
+				bx - nx * br, by - ny * br, bz - nz * br);
+		}
+	};
+
+	// Inputs: center and radius of the sphere A, world min and max of the box B.
+	struct SphereBoxKernel {
+		template<class V>
+		static void run(const Columns& c, size_t i) {
+			const V cx = load<V>(c[0] + i), cy = load<V>(c[1] + i), cz = load<V>(c[2] + i), r = load<V>(c[3] + i);
+			const V minx = load<V>(c[4] + i), miny = load<V>(c[5] + i), minz = load<V>(c[6] + i);
+			const V maxx = load<V>(c[7] + i), maxy = load<V>(c[8] + i), maxz = load<V>(c[9] + i);
+			const V one = splat<V>(1.0f);
+
+			// Closest point of the box to the center
+			const V qx = min(max(cx, minx), maxx), qy = min(max(cy, miny), maxy), qz = min(max(cz, minz), maxz);
+			const V dx = qx - cx, dy = qy - cy, dz = qz - cz;
+			const V distanceSquared = dx * dx + dy * dy + dz * dz;
+			const auto hit = distanceSquared <= r * r;
+
+			// Center outside the box: the normal points to the closest point.
+			const V distance = sqrt(distanceSquared);
+			const V inverse = one / distance;
+			const auto outside = distance > splat<V>(1e-6f);
+
+			// Center inside the box: push the sphere out through the nearest face.
+			const V toMinX = cx - minx, toMaxX = maxx - cx;
+			const V toMinY = cy - miny, toMaxY = maxy - cy;
+			const V toMinZ = cz - minz, toMaxZ = maxz - cz;
+			V inx, iny, inz, face;
+			minAxis<V>(min(toMinX, toMaxX), min(toMinY, toMaxY), min(toMinZ, toMaxZ),
+				select(toMaxX < toMinX, -one, one), select(toMaxY < toMinY, -one, one), select(toMaxZ < toMinZ, -one, one),
+				inx, iny, inz, face);
+
+			const V nx = select(outside, dx * inverse, inx);
+			const V ny = select(outside, dy * inverse, iny);
+			const V nz = select(outside, dz * inverse, inz);
+			const V depth = select(outside, r - distance, r + face);
+			const V pbx = select(outside, qx, cx - nx * face);
+			const V pby = select(outside, qy, cy - ny * face);
+			const V pbz = select(outside, qz, cz - nz * face);
+
+			storeContact<V>(c, i, hit, nx, ny, nz, depth, cx + nx * r, cy + ny * r, cz + nz * r, pbx, pby, pbz);
+		}
+	};
+
+	// Inputs: world min and max of box A, world min and max of box B.
+	struct BoxBoxKernel {
+		template<class V>
+		static void run(const Columns& c, size_t i) {
+			const V aminx = load<V>(c[0] + i), aminy = load<V>(c[1] + i), aminz = load<V>(c[2] + i);
+			const V amaxx = load<V>(c[3] + i), amaxy = load<V>(c[4] + i), amaxz = load<V>(c[5] + i);
+			const V bminx = load<V>(c[6] + i), bminy = load<V>(c[7] + i), bminz = load<V>(c[8] + i);
+			const V bmaxx = load<V>(c[9] + i), bmaxy = load<V>(c[10] + i), bmaxz = load<V>(c[11] + i);
+			const V zero = splat<V>(0.0f), one = splat<V>(1.0f), half = splat<V>(0.5f);
+
+			// Distance A has to move down or up each axis to stop overlapping B
+			const V downX = amaxx - bminx, upX = bmaxx - aminx;
+			const V downY = amaxy - bminy, upY = bmaxy - aminy;
+			const V downZ = amaxz - bminz, upZ = bmaxz - aminz;
+			const V px = min(downX, upX), py = min(downY, upY), pz = min(downZ, upZ);
+			const auto hit = (px >= zero) & (py >= zero) & (pz >= zero);
+
+			// Separate along the shortest of them, the normal points from A to B
+			V nx, ny, nz, depth;
+			minAxis<V>(px, py, pz, select(downX < upX, one, -one), select(downY < upY, one, -one), select(downZ < upZ, one, -one),
+				nx, ny, nz, depth);
+
+			// Contact points around the middle of the overlap region
+			const V lox = max(aminx, bminx), loy = max(aminy, bminy), loz = max(aminz, bminz);
+			const V hix = min(amaxx, bmaxx), hiy = min(amaxy, bmaxy), hiz = min(amaxz, bmaxz);
+			const V mx = (lox + hix) * half, my = (loy + hiy) * half, mz = (loz + hiz) * half;
+			const V h = depth * half;
+			storeContact<V>(c, i, hit, nx, ny, nz, depth, mx + nx * h, my + ny * h, mz + nz * h, mx - nx * h, my - ny * h, mz - nz * h);
+		}
+	};
+
+	template<class Kernel>
+	void runKernel(const Columns& c, size_t count) {
+		size_t i = 0;
+		for (; i + width<FloatN> <= count; i += width<FloatN>) {
+			Kernel::template run<FloatN>(c, i);
+		}
+		for (; i < count; i++) {
+			Kernel::template run<float>(c, i);
+		}
+	}
+}
+
+template<class Kernel, class Gather>
+void NarrowPhase::runBucket(Bucket bucket, std::span<const NarrowPhasePair> pairs, std::span<NarrowPhaseResult> results, bool swapped, Gather&& gather) {
+	const std::vector<uint32_t>& indices = m_buckets[bucket];
+	const size_t count = indices.size();
+	if (count == 0) {
+		return;
+	}
+	m_columns.resize(count * COLUMN_COUNT);
+	const Columns c{ m_columns.data(), count };
+
+	for (size_t i = 0; i < count; i++) {
+		gather(c, i, pairs[indices[i]]);
+	}
+	runKernel<Kernel>(c, count);
+
+	for (size_t i = 0; i < count; i++) {
+		NarrowPhaseResult& result = results[indices[i]];
+		result.hit = c[OUT_HIT][i] != 0.0f;
+		if (!result.hit) {
+			continue;
+		}
+		Contact& contact = result.contact;
+		contact.Normal = glm::vec3(c[OUT_NX][i], c[OUT_NY][i], c[OUT_NZ][i]);
+		contact.Depth = c[OUT_DEPTH][i];
+		contact.PointA = glm::vec3(c[OUT_PAX][i], c[OUT_PAY][i], c[OUT_PAZ][i]);
+		contact.PointB = glm::vec3(c[OUT_PBX][i], c[OUT_PBY][i], c[OUT_PBZ][i]);
+		// The kernel ran with the shapes the other way around.
+		if (swapped) {
+			contact.Normal = -contact.Normal;
+			std::swap(contact.PointA, contact.PointB);
+		}
+	}
+}
+
+void NarrowPhase::collide(std::span<const NarrowPhasePair> pairs, std::span<NarrowPhaseResult> results) {
+	for (auto& bucket : m_buckets) {
+		bucket.clear();
+	}
+	for (uint32_t i = 0; i < pairs.size(); i++) {
+		const bool sphereA = std::holds_alternative<Sphere>(*pairs[i].shapeA);
+		const bool sphereB = std::holds_alternative<Sphere>(*pairs[i].shapeB);
+		const bool boxA = std::holds_alternative<Box>(*pairs[i].shapeA);
+		const bool boxB = std::holds_alternative<Box>(*pairs[i].shapeB);
+		Bucket bucket = General;
+		if (sphereA && sphereB) {
+			bucket = SphereSphere;
+		} else if (sphereA && boxB) {
+			bucket = SphereBox;
+		} else if (boxA && sphereB) {
+			bucket = BoxSphere;
+		} else if (boxA && boxB) {
+			bucket = BoxBox;
+		}
+		m_buckets[bucket].push_back(i);
+	}
+
+	auto sphere = [](const Columns& c, size_t i, size_t column, const ColliderShape& shape, glm::vec3 position) {
+		c[column][i] = position.x;
+		c[column + 1][i] = position.y;
+		c[column + 2][i] = position.z;
+		c[column + 3][i] = std::get<Sphere>(shape).Radius;
+	};
+	auto box = [](const Columns& c, size_t i, size_t column, const ColliderShape& shape, glm::vec3 position) {
+		const Box& b = std::get<Box>(shape);
+		for (int axis = 0; axis < 3; axis++) {
+			c[column + axis][i] = position[axis] + b.Min[axis];
+			c[column + 3 + axis][i] = position[axis] + b.Max[axis];
+		}
+	};
+
+	runBucket<SphereSphereKernel>(SphereSphere, pairs, results, false, [&](const Columns& c, size_t i, const NarrowPhasePair& pair) {
+		sphere(c, i, 0, *pair.shapeA, pair.positionA);
+		sphere(c, i, 4, *pair.shapeB, pair.positionB);
+	});
+	runBucket<SphereBoxKernel>(SphereBox, pairs, results, false, [&](const Columns& c, size_t i, const NarrowPhasePair& pair) {
+		sphere(c, i, 0, *pair.shapeA, pair.positionA);
+		box(c, i, 4, *pair.shapeB, pair.positionB);
+	});
+	runBucket<SphereBoxKernel>(BoxSphere, pairs, results, true, [&](const Columns& c, size_t i, const NarrowPhasePair& pair) {
+		sphere(c, i, 0, *pair.shapeB, pair.positionB);
+		box(c, i, 4, *pair.shapeA, pair.positionA);
+	});
+	runBucket<BoxBoxKernel>(BoxBox, pairs, results, false, [&](const Columns& c, size_t i, const NarrowPhasePair& pair) {
+		box(c, i, 0, *pair.shapeA, pair.positionA);
+		box(c, i, 6, *pair.shapeB, pair.positionB);
+	});
+
+	for (uint32_t index : m_buckets[General]) {
+		const NarrowPhasePair& pair = pairs[index];
+		results[index].hit = Physics::collide(*pair.shapeA, pair.positionA, *pair.shapeB, pair.positionB, results[index].contact);
+	}
+
+	buildManifolds(pairs, results);
+}
+
+void NarrowPhase::buildManifolds(std::span<const NarrowPhasePair> pairs, std::span<NarrowPhaseResult> results) {
+	auto single = [&](uint32_t index, uint32_t id) {
+		NarrowPhaseResult& result = results[index];
+		const Contact& contact = result.contact;
+		result.manifold.Normal = contact.Normal;
+		result.manifold.PointCount = 1;
+		result.manifold.Points[0] = ContactPoint{
+			.LocalA = contact.PointA - pairs[index].positionA,
+			.LocalB = contact.PointB - pairs[index].positionB,
+			.Depth = contact.Depth,
+			.Id = id
+		};
+	};
+	// Sphere against a box face, edge or corner region. The id is the face the normal is closest
+	// to, so the point keeps its impulse while the sphere rolls over a face.
+	auto faceId = [](glm::vec3 normal) {
+		const glm::vec3 a = glm::abs(normal);
+		const uint32_t axis = (a.x >= a.y && a.x >= a.z) ? 0 : (a.y >= a.z ? 1 : 2);
+		return axis * 2 + (normal[axis] < 0.0f ? 1 : 0);
+	};
+
+	for (uint32_t bucket = 0; bucket < BucketCount; bucket++) {
+		for (uint32_t index : m_buckets[bucket]) {
+			NarrowPhaseResult& result = results[index];
+			result.accumulate = bucket == General;
+			if (!result.hit) {
+				result.manifold.PointCount = 0;
+				continue;
+			}
+			if (bucket == SphereSphere || bucket == General) {
+				single(index, 0);
+			} else if (bucket == SphereBox || bucket == BoxSphere) {
+				single(index, faceId(result.contact.Normal));
+			} else {
+				// Box-box: the corners of the overlap of the two touching faces.
+				const NarrowPhasePair& pair = pairs[index];
+				const Box& a = std::get<Box>(*pair.shapeA);
+				const Box& b = std::get<Box>(*pair.shapeB);
+				const glm::vec3 aMin = pair.positionA + a.Min, aMax = pair.positionA + a.Max;
+				const glm::vec3 bMin = pair.positionB + b.Min, bMax = pair.positionB + b.Max;
+				const glm::vec3 lo = glm::max(aMin, bMin);
+				const glm::vec3 hi = glm::min(aMax, bMax);
+
+				const glm::vec3 n = result.contact.Normal;
+				const int k = n.x != 0.0f ? 0 : (n.y != 0.0f ? 1 : 2);
+				const int u = (k + 1) % 3;
+				const int v = (k + 2) % 3;
+				const bool positive = n[k] > 0.0f;
+				// The face of A pushing into B, and the face of B pushing into A.
+				const float faceA = positive ? aMax[k] : aMin[k];
+				const float faceB = positive ? bMin[k] : bMax[k];
+
+				ContactManifold& manifold = result.manifold;
+				manifold.Normal = n;
+				manifold.PointCount = MAX_MANIFOLD_POINTS;
+				for (uint32_t corner = 0; corner < MAX_MANIFOLD_POINTS; corner++) {
+					glm::vec3 pointA{}, pointB{};
+					pointA[u] = pointB[u] = (corner == 1 || corner == 2) ? hi[u] : lo[u];
+					pointA[v] = pointB[v] = (corner >= 2) ? hi[v] : lo[v];
+					pointA[k] = faceA;
+					pointB[k] = faceB;
+					manifold.Points[corner] = ContactPoint{
+						.LocalA = pointA - pair.positionA,
+						.LocalB = pointB - pair.positionB,
+						.Depth = result.contact.Depth,
+						.Id = static_cast<uint32_t>(k) * 8 + (positive ? 4 : 0) + corner
+					};
+				}
+			}
+		}
+	}
+}
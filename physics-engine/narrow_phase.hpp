@@ -0,0 +1,58 @@
+#pragma once
+#include "collider.hpp"
+#include "gjk.hpp"
+#include "epa.hpp"
+#include "manifold.hpp"
+#include <array>
+#include <span>
+#include <vector>
+
+namespace Physics {
+
+	// Tests two colliders placed at the given positions for intersection with GJK, then runs EPA
+	// on the final simplex to find the contact normal and depth. The pair of shape types is
+	// resolved with std::visit, each combination gets its own gjk instantiation. Bodies without a
+	// collider (std::monostate) never collide here, the physics system gives every body one.
+	// Returns false if the shapes do not intersect; then contact is left untouched. Pairs with a
+	// heightfield are collided triangle by triangle instead, see HeightFieldPrism, and pairs with
+	// a level against its BSP tree.
+	bool collide(const ColliderShape& a, glm::vec3 positionA, const ColliderShape& b, glm::vec3 positionB, Contact& contact);
+
+	// A pair handed to the batched narrow phase. The shapes must outlive NarrowPhase::collide.
+	struct NarrowPhasePair {
+		const ColliderShape* shapeA;
+		const ColliderShape* shapeB;
+		glm::vec3 positionA;
+		glm::vec3 positionB;
+	};
+
+	struct NarrowPhaseResult {
+		// The deepest contact, and all contact points (with ids but no impulses).
+		Contact contact;
+		ContactManifold manifold;
+		bool hit;
+		// The manifold is a single point found by GJK and EPA, to be merged into the cached one
+		// with ContactManifold::merge(..., accumulate = true).
+		bool accumulate;
+	};
+
+	// Batched narrow phase. Pairs are bucketed by the types of their shapes; sphere-sphere,
+	// sphere-box and box-box buckets run analytic kernels over structure-of-arrays copies of their
+	// pairs, as many pairs at a time as the SIMD width allows. Everything else goes through
+	// GJK and EPA. Buffers are kept between calls.
+	class NarrowPhase {
+	public:
+		// Fills results[i] for pairs[i].
+		void collide(std::span<const NarrowPhasePair> pairs, std::span<NarrowPhaseResult> results);
+	private:
+		enum Bucket { SphereSphere, SphereBox, BoxSphere, BoxBox, General, BucketCount };
+
+		void buildManifolds(std::span<const NarrowPhasePair> pairs, std::span<NarrowPhaseResult> results);
+
+		template<class Kernel, class Gather>
+		void runBucket(Bucket bucket, std::span<const NarrowPhasePair> pairs, std::span<NarrowPhaseResult> results, bool swapped, Gather&& gather);
+	private:
+		std::array<std::vector<uint32_t>, BucketCount> m_buckets{};
+		std::vector<float> m_columns{};
+	};
+}
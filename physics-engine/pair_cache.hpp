@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include "aabb_tree.hpp"
+#include "manifold.hpp"
+
+namespace Physics {
+
+	// Order independent key of two entities.
+	using PairKey = uint64_t;
+
+	inline PairKey makePairKey(Entity a, Entity b) {
+		return a < b ? (static_cast<PairKey>(a) << 32) | b : (static_cast<PairKey>(b) << 32) | a;
+	}
+
+	// What the bodies of a pair did at their last narrow phase.
+	enum class PairContact : uint8_t {
+		None,
+		// Solid bodies touching, the manifold has their points.
+		Touching,
+		// A sensor overlapping the other body. The manifold stays empty, nothing is solved.
+		Triggered
+	};
+
+	// A pair of bodies whose fat boxes overlap. It stays in the cache for as long as they keep
+	// overlapping, which is what lets per-pair state carry over from one step to the next.
+	// For a dynamic-static pair the dynamic entity is always a, for a dynamic-dynamic pair the lower entity is a.
+	struct CachedPair {
+		Entity a;
+		Entity b;
+		// Proxies of a and b. a is always in the dynamic tree.
+		NodeIndex proxyA;
+		NodeIndex proxyB;
+		// b is in the static tree.
+		bool isStatic;
+		// Touching exactly when the manifold has points.
+		PairContact contact = PairContact::None;
+		// The other pairs of a (index 0) and of b (index 1), as doubly linked lists, so that the
+		// pairs of a body are found without going through all of them. See BroadPhase::forEachPair.
+		// Walking them only reads the fields up to here, the manifold comes last.
+		CachedPair* next[2]{};
+		CachedPair* prev[2]{};
+		// Contact points from the last step, with the solver's impulses for warm starting.
+		ContactManifold manifold{};
+
+		// Index of the list of entity, which is a or b.
+		int side(Entity entity) const { return entity == a ? 0 : 1; }
+	};
+
+	enum class PairEventType : uint8_t {
+		Begin,
+		End
+	};
+
+	struct PairEvent {
+		PairEventType type;
+		Entity a;
+		Entity b;
+		// For an end, what the pair did up to then.
+		PairContact contact = PairContact::None;
+	};
+
+	using PairCache = std::unordered_map<PairKey, CachedPair>;
+}
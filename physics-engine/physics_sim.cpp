@@ -1,4 +1,11 @@
 #include "physics_sim.hpp"
+#include "coordinator.hpp"
+#include "components.hpp"
+#include <algorithm>
+
+PhysicsSim::~PhysicsSim() {
+	stop();
+}
 
 void PhysicsSim::init() {
 	m_system->init();
@@ -7,3 +14,149 @@ void PhysicsSim::init() {
 void PhysicsSim::simulate() {
 	m_system->update(*m_dt);
 }
+
+void PhysicsSim::start(int maxSteps) {
+	if (m_running.exchange(true)) {
+		return;
+	}
+	m_system->setDeferredDestruction(true);
+	m_thread = std::thread(&PhysicsSim::run, this, maxSteps);
+}
+
+void PhysicsSim::stop() {
+	if (!m_running.exchange(false)) {
+		return;
+	}
+	m_thread.join();
+	m_system->setDeferredDestruction(false);
+	m_system->destroyDetached();
+}
+
+/* Steps are due every dt. The thread sleeps until the next one is, and runs every step that is
+   due when it wakes, dropping the ones beyond maxSteps so it does not fall further behind. */
+void PhysicsSim::run(int maxSteps) {
+	using Clock = std::chrono::steady_clock;
+	const auto step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(*m_dt));
+	Clock::time_point due = Clock::now();
+
+	while (m_running.load(std::memory_order_relaxed)) {
+		const Clock::time_point now = Clock::now();
+		if (now < due) {
+			std::this_thread::sleep_until(due);
+			continue;
+		}
+		// Steps from due to now, both included, are run: at most maxSteps of them
+		const auto behind = step * (std::max(maxSteps, 1) - 1);
+		if (now - due > behind) {
+			due = now - behind;
+		}
+
+		while (due <= now) {
+			{
+				std::lock_guard<std::mutex> lock(m_worldMutex);
+				PhysicsCommand command;
+				while (m_commands.pop(command)) {
+					apply(command);
+				}
+				m_system->update(static_cast<float>(*m_dt));
+				publish(due);
+				forwardEvents();
+				due += step;
+				if (m_system->hasDetached()) {
+					m_removedPending.store(true, std::memory_order_release);
+				}
+			}
+		}
+	}
+}
+
+void PhysicsSim::apply(const PhysicsCommand& command) {
+	if (command.type == PhysicsCommand::Type::SwitchGravity) {
+		m_system->switchGravity();
+		return;
+	}
+	if (command.type == PhysicsCommand::Type::SetViewer) {
+		m_system->setViewer(command.value);
+		return;
+	}
+	// The entity may have been destroyed since the command was sent
+	if (!m_system->m_entities.contains(command.entity)) {
+		return;
+	}
+	auto& rigidBody = m_system->m_coordinator.getComponent<Components::RigidBody>(command.entity);
+	switch (command.type) {
+	case PhysicsCommand::Type::AddForce:
+		rigidBody.Force += command.value;
+		m_system->wake(command.entity);
+		break;
+	case PhysicsCommand::Type::SetVelocity:
+		rigidBody.Velocity = command.value;
+		m_system->wake(command.entity);
+		break;
+	case PhysicsCommand::Type::Teleport:
+		m_system->teleport(command.entity, command.value);
+		break;
+	case PhysicsCommand::Type::Wake:
+		m_system->wake(command.entity);
+		break;
+	case PhysicsCommand::Type::Remove:
+		m_system->removeEntity(command.entity);
+		break;
+	default:
+		break;
+	}
+}
+
+/* Copies the bodies of the step into the back frame, only the dense arrays: the entity slots stay
+   with the physics thread. The copy reuses the frame's storage, so it only allocates while the
+   number of bodies grows. */
+void PhysicsSim::publish(std::chrono::steady_clock::time_point time) {
+	PhysicsFrame& frame = m_frames.back();
+	frame.bodies = m_system->getInterpolation().getFrame();
+	frame.time = time;
+	m_frames.publish();
+}
+
+/* Queues the events of the step for the main thread. */
+void PhysicsSim::forwardEvents() {
+	for (const Physics::ContactEvent& event : m_system->getContactEvents().get()) {
+		if (event.Type != Physics::ContactEventType::ContactPersist) {
+			m_events.push(event);
+		}
+	}
+}
+
+bool PhysicsSim::push(const PhysicsCommand& command) {
+	return m_commands.push(command);
+}
+
+const PhysicsFrame& PhysicsSim::acquireFrame() {
+	return m_frames.acquire();
+}
+
+bool PhysicsSim::pollEvent(Physics::ContactEvent& event) {
+	return m_events.pop(event);
+}
+
+double PhysicsSim::getAlpha(const PhysicsFrame& frame) const {
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - frame.time).count();
+	return std::clamp(elapsed / *m_dt, 0.0, 1.0);
+}
+
+void PhysicsSim::collectRemoved() {
+	if (!m_removedPending.exchange(false, std::memory_order_acquire)) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_worldMutex);
+	m_system->destroyDetached();
+}
+
+uint32_t PhysicsSim::addPlane(const Physics::StaticPlane& plane) {
+	std::lock_guard<std::mutex> lock(m_worldMutex);
+	return m_system->addPlane(plane);
+}
+
+void PhysicsSim::removePlane(uint32_t plane) {
+	std::lock_guard<std::mutex> lock(m_worldMutex);
+	m_system->removePlane(plane);
+}
@@ -1,6 +1,43 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
 #include "systems.hpp"
+#include "spsc_queue.hpp"
+#include "triple_buffer.hpp"
+
+/* A change to the simulation sent from the main thread, applied before the next physics step. */
+struct PhysicsCommand {
+	enum class Type : uint8_t {
+		AddForce,
+		SetVelocity,
+		Teleport,
+		Wake,
+		Remove,
+		SwitchGravity,
+		/* value is where the viewer is, for the physics LOD. entity is unused. */
+		SetViewer
+	};
+
+	Type type;
+	Entity entity;
+	glm::vec3 value;
+};
+
+/* What a physics step publishes for the render thread. */
+struct PhysicsFrame {
+	Physics::InterpolationFrame bodies;
+	/* When the step was due, on std::chrono::steady_clock. Frames drawn from then until the next
+	   step move the bodies from their previous to their current position. */
+	std::chrono::steady_clock::time_point time;
+};
+
+/* Commands that can wait for the physics thread. Pushing more than this between two steps drops them. */
+constexpr size_t PHYSICS_COMMAND_CAPACITY = 1024;
+/* Contact events that can wait for the main thread. The ones past it between two polls are dropped. */
+constexpr size_t PHYSICS_EVENT_CAPACITY = 1024;
 
 class PhysicsSim {
 public:
@@ -10,11 +47,53 @@ public:
 	) : 
 		m_system(s),
 		m_dt(dt) { }
-	~PhysicsSim() = default;
+	~PhysicsSim();
 public:
 	void init();
+	/* Runs a single step on the calling thread. Not to be mixed with start(). */
 	void simulate();
+
+	/* Runs the simulation on its own thread in fixed steps of dt, catching up at most maxSteps
+	   at a time after a stall. From here on the main thread talks to physics only through
+	   push(), acquireFrame(), pollEvent() and lockWorld(). */
+	void start(int maxSteps);
+	void stop();
+
+	/* Main thread only. Returns false if the queue is full. */
+	bool push(const PhysicsCommand& command);
+	/* Main thread only. The last state published by the physics thread. */
+	const PhysicsFrame& acquireFrame();
+	/* Main thread only. Takes the oldest contact event of the steps so far, see
+	   PhysicsSystem::getContactEvents. Returns false if there is none. Persist events stay on the
+	   physics thread, a pile at rest would fill the queue every step. */
+	bool pollEvent(Physics::ContactEvent& event);
+	/* How far now is between the previous and the current state of frame, from 0 to 1. */
+	double getAlpha(const PhysicsFrame& frame) const;
+	/* Main thread only. Destroys the entities physics removed, if any. Call once a frame, outside
+	   of anything iterating over the coordinator. */
+	void collectRemoved();
+	/* Main thread only. Static planes, see PhysicsSystem::addPlane. Waits for the current step. */
+	uint32_t addPlane(const Physics::StaticPlane& plane);
+	void removePlane(uint32_t plane);
+	/* Holding the lock keeps the physics thread between steps, e.g. to create or destroy bodies. */
+	std::unique_lock<std::mutex> lockWorld() { return std::unique_lock<std::mutex>(m_worldMutex); }
+private:
+	void run(int maxSteps);
+	void apply(const PhysicsCommand& command);
+	void publish(std::chrono::steady_clock::time_point time);
+	void forwardEvents();
 private:
 	std::shared_ptr<Systems::PhysicsSystem> m_system;
 	std::shared_ptr<double> m_dt;
+
+	std::thread m_thread{};
+	std::atomic<bool> m_running{ false };
+	/* Held by the physics thread for every step. */
+	std::mutex m_worldMutex{};
+	/* Main thread to physics thread. */
+	SpscQueue<PhysicsCommand, PHYSICS_COMMAND_CAPACITY> m_commands{};
+	/* Physics thread to main thread. */
+	TripleBuffer<PhysicsFrame> m_frames{};
+	SpscQueue<Physics::ContactEvent, PHYSICS_EVENT_CAPACITY> m_events{};
+	std::atomic<bool> m_removedPending{ false };
 };
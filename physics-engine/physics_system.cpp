@@ -1,10 +1,14 @@
 #include "physics_system.hpp"
 #include "coordinator.hpp"
 #include "components.hpp"
-#include "gjk.hpp"
+#include "narrow_phase.hpp"
 #include "plane.hpp"
 
 #include <format>
+#include <algorithm>
+#include <chrono>
+#include <execution>
+#include <numeric>
 
 using namespace Systems;
 
@@ -15,128 +19,714 @@ void PhysicsSystem::switchGravity() {
 	m_gravity = !m_gravity;
 }
 
-void PhysicsSystem::collision(Entity me, float deltaTime) {
-	/* Naiive implementation */
-	for (Entity other : m_entities) {
-		if (other == me) {
-			continue;
+namespace {
+	/* The event of a contact that begins or goes on, at its deepest point. */
+	Physics::ContactEvent touchEvent(Physics::ContactEventType type, Entity a, Entity b, uint32_t plane, const Physics::ContactManifold& manifold, glm::vec3 positionA) {
+		Physics::ContactEvent event{ type, a, b, plane, manifold.Normal };
+		for (uint32_t k = 0; k < manifold.PointCount; k++) {
+			if (k == 0 || manifold.Points[k].Depth > event.Depth) {
+				event.Point = positionA + manifold.Points[k].LocalA;
+				event.Depth = manifold.Points[k].Depth;
+			}
 		}
-		auto& p = m_coordinator.getComponent<Components::Transform>(me);
-		auto& pBody = m_coordinator.getComponent<Components::RigidBody>(me);
-		auto& q = m_coordinator.getComponent<Components::Transform>(other);
-		auto& qBody = m_coordinator.getComponent<Components::RigidBody>(other);
+		return event;
+	}
 
-		BoundingBox qWorldBox = BoundingBox(qBody.Box, q.Position);
-		BoundingBox pWorldBox = BoundingBox(pBody.Box, p.Position);
+	Physics::ContactEventType endOf(Physics::PairContact contact) {
+		return contact == Physics::PairContact::Triggered ? Physics::ContactEventType::TriggerExit : Physics::ContactEventType::ContactEnd;
+	}
+}
 
-		if (qWorldBox.overlaps(pWorldBox)) {
-			pBody.Box.overlapping = true;
-			qBody.Box.overlapping = true;
-			const glm::vec3 overlap = qWorldBox.overlap(pWorldBox);
+/* Runs the batched narrow phase over the pairs of the stepping bodies, updates their manifolds and
+   reports the pairs whose contact began, went on or ended. Pairs with a sensor are only tested,
+   not solved. */
+void PhysicsSystem::narrowPhase() {
+	/* a body is flagged overlapping while any of its pairs touches or triggers, the ones that
+	   are not stepping are flagged here as their pairs change */
+	auto countTouching = [this](Entity entity, bool touching) {
+		m_touchingPairs[entity] = touching ? m_touchingPairs[entity] + 1 : m_touchingPairs[entity] - 1;
+		if (m_broadPhase.contains(entity)) {
+			m_coordinator.getComponent<Components::RigidBody>(entity).Box.overlapping = m_touchingPairs[entity] > 0;
+		}
+	};
+
+	/* pairs the broad phase dropped, e.g. for a removed body, end what they were doing */
+	for (const Physics::PairEvent& event : m_broadPhase.getPairEvents()) {
+		if (event.type == Physics::PairEventType::End && event.contact != Physics::PairContact::None) {
+			m_contactEvents.push(Physics::ContactEvent{ endOf(event.contact), event.a, event.b });
+			countTouching(event.a, false);
+			countTouching(event.b, false);
+		}
+	}
 
-			// correct q's position
-			q.Position -= overlap;
-			// p.Position += overlap;
+	/* Pairs between bodies that are not stepping are left out: nothing moved, the manifold from
+	   the step the bodies fell asleep (or last stepped) still holds. A pair of two stepping bodies
+	   is taken from its a. */
+	m_narrowCached.clear();
+	m_narrowPairs.clear();
+	for (Entity entity : m_activeBodies) {
+		m_broadPhase.forEachPair(entity, [this, entity](Physics::CachedPair& pair) {
+			if (pair.b == entity && m_lod.isStepping(pair.a)) {
+				return;
+			}
+			const auto& p = m_coordinator.getComponent<Components::Transform>(pair.a);
+			const auto& pBody = m_coordinator.getComponent<Components::RigidBody>(pair.a);
+			const auto& q = m_coordinator.getComponent<Components::Transform>(pair.b);
+			const auto& qBody = m_coordinator.getComponent<Components::RigidBody>(pair.b);
+			m_narrowCached.push_back(&pair);
+			m_narrowPairs.push_back(Physics::NarrowPhasePair{ &pBody.Collider, &qBody.Collider, p.Position, q.Position });
+		});
+	}
+	m_narrowResults.resize(m_narrowPairs.size());
+	m_narrowPhase.collide(m_narrowPairs, m_narrowResults);
+
+	// Update the cached manifolds, keeping the impulses of points that persist
+	for (size_t i = 0; i < m_narrowResults.size(); i++) {
+		Physics::CachedPair& pair = *m_narrowCached[i];
+		const Physics::NarrowPhaseResult& result = m_narrowResults[i];
+		const Physics::PairContact previous = pair.contact;
+		const bool sensor = m_coordinator.getComponent<Components::RigidBody>(pair.a).Sensor || m_coordinator.getComponent<Components::RigidBody>(pair.b).Sensor;
+		if (!result.hit || sensor) {
+			pair.manifold.clear();
+			pair.contact = result.hit ? Physics::PairContact::Triggered : Physics::PairContact::None;
+		} else {
+			pair.manifold.merge(result.manifold, m_narrowPairs[i].positionA, m_narrowPairs[i].positionB, result.accumulate);
+			pair.contact = pair.manifold.PointCount > 0 ? Physics::PairContact::Touching : Physics::PairContact::None;
+		}
 
-			// std::cout << "overlap: [" << overlap.x << ", " << overlap.y << ", " << overlap.z << "]\n";
+		if ((previous == Physics::PairContact::None) != (pair.contact == Physics::PairContact::None)) {
+			countTouching(pair.a, previous == Physics::PairContact::None);
+			countTouching(pair.b, previous == Physics::PairContact::None);
+		}
+		if (previous != pair.contact && previous != Physics::PairContact::None) {
+			m_contactEvents.push(Physics::ContactEvent{ endOf(previous), pair.a, pair.b });
+		}
+		if (pair.contact == Physics::PairContact::Touching && previous != Physics::PairContact::Touching) {
+			m_contactEvents.push(touchEvent(Physics::ContactEventType::ContactBegin, pair.a, pair.b, 0, pair.manifold, m_narrowPairs[i].positionA));
+		} else if (pair.contact == Physics::PairContact::Touching && m_contactEvents.getPersist()) {
+			m_contactEvents.push(touchEvent(Physics::ContactEventType::ContactPersist, pair.a, pair.b, 0, pair.manifold, m_narrowPairs[i].positionA));
+		} else if (pair.contact == Physics::PairContact::Triggered && previous != Physics::PairContact::Triggered) {
+			m_contactEvents.push(touchEvent(Physics::ContactEventType::TriggerEnter, pair.a, pair.b, 0, result.manifold, m_narrowPairs[i].positionA));
+		}
+	}
+}
 
-			// velocity change equation
-			const glm::vec3 pOldVel = pBody.Velocity;
-			const glm::vec3 qOldVel = qBody.Velocity;
-			pBody.Velocity = ((pOldVel * (pBody.Mass - qBody.Mass)) + (2.0f * (qBody.Mass * qOldVel))) / (pBody.Mass + qBody.Mass) * pBody.Restitution;
-			qBody.Velocity = ((qOldVel * (qBody.Mass - pBody.Mass)) + (2.0f * (pBody.Mass * pOldVel))) / (pBody.Mass + qBody.Mass) * qBody.Restitution;
+/* Tests the moving bodies against the static planes. Sensors pass through them. */
+void PhysicsSystem::collidePlanes() {
+	m_planes.resize(m_planes.empty() ? 0 : m_activeBodies.size());
+	for (size_t i = 0; i < m_planes.size(); i++) {
+		const Entity entity = m_activeBodies[i];
+		const auto& transform = m_coordinator.getComponent<Components::Transform>(entity);
+		const auto& rigidBody = m_coordinator.getComponent<Components::RigidBody>(entity);
+		m_planes.set(i, entity, transform.Position, BoundingBox(rigidBody.Box, transform.Position), rigidBody.Collider, rigidBody.Layer, rigidBody.Sensor ? Physics::Layers::None : rigidBody.Mask);
+	}
+	m_planes.collide();
+}
 
-		} else {
-			pBody.Box.overlapping = false;
+/* Reports the contacts with the planes, and flags the stepping bodies touching anything as
+   overlapping. Sleeping and parked bodies did not move, the narrow phase flags them. */
+void PhysicsSystem::reportContacts() {
+	for (Entity entity : m_activeBodies) {
+		m_coordinator.getComponent<Components::RigidBody>(entity).Box.overlapping = m_touchingPairs[entity] > 0;
+	}
+
+	for (const Physics::PlaneContact& contact : m_planes.getContacts()) {
+		if (contact.began || m_contactEvents.getPersist()) {
+			const auto type = contact.began ? Physics::ContactEventType::ContactBegin : Physics::ContactEventType::ContactPersist;
+			const glm::vec3 position = m_coordinator.getComponent<Components::Transform>(contact.body).Position;
+			m_contactEvents.push(touchEvent(type, contact.body, MAX_ENTITIES, contact.plane, *contact.manifold, position));
+		}
+		m_coordinator.getComponent<Components::RigidBody>(contact.body).Box.overlapping = true;
+	}
+	for (const Physics::PlaneContact& contact : m_planes.getEnded()) {
+		m_contactEvents.push(Physics::ContactEvent{ Physics::ContactEventType::ContactEnd, contact.body, MAX_ENTITIES, contact.plane });
+	}
+}
+
+/* Hands the manifolds of every touching pair to the contact solver and solves them. The bodies
+   must already have been added to the solver. */
+void PhysicsSystem::solveContacts(float deltaTime) {
+	for (Physics::CachedPair* pair : m_narrowCached) {
+		if (pair->manifold.PointCount == 0) {
+			continue;
 		}
+		const auto& a = m_coordinator.getComponent<Components::RigidBody>(pair->a);
+		const auto& b = m_coordinator.getComponent<Components::RigidBody>(pair->b);
+		m_solver.addManifold(pair->manifold, m_solverBodies[pair->a], m_solverBodies[pair->b],
+			std::min(a.Restitution, b.Restitution), std::sqrt(a.Friction * b.Friction));
+	}
+	for (const Physics::PlaneContact& contact : m_planes.getContacts()) {
+		const auto& body = m_coordinator.getComponent<Components::RigidBody>(contact.body);
+		const Physics::StaticPlane& plane = m_planes.getPlane(contact.plane);
+		m_solver.addManifold(*contact.manifold, m_solverBodies[contact.body], Physics::STATIC_SOLVER_BODY,
+			std::min(body.Restitution, plane.Restitution), std::sqrt(body.Friction * plane.Friction));
 	}
+	m_solver.solve(m_solverSettings, deltaTime);
 }
 
+/* Each swept body is moved to its first time of impact against everything else in its final
+   place, bounced off the contact normal, and moved on for the rest of the step. */
 void PhysicsSystem::future(float futureTime) {
-	/* Naiive implementation */
-	//for (Entity me : m_entities) {
-	//	for (Entity other : m_entities) {
-	//		if (other == me) {
-	//			continue;
-	//		}
+	for (const SweptBody& swept : m_sweptBodies) {
+		auto& transform = m_coordinator.getComponent<Components::Transform>(swept.entity);
+		auto& rigidBody = m_coordinator.getComponent<Components::RigidBody>(swept.entity);
+		glm::vec3 motion = swept.motion;
+		float time = futureTime * m_lod.getTimeScale(swept.entity);
+
+		for (int substep = 0; substep < Physics::CCD_MAX_SUBSTEPS; substep++) {
+			float first = 1.0f;
+			glm::vec3 normal{};
+			Entity target{};
+			uint32_t plane{};
+			/* the planes first, a body hit sooner takes their place */
+			bool hit = !rigidBody.Sensor && m_planes.timeOfImpact(rigidBody.Collider, transform.Position, motion, rigidBody.Layer, rigidBody.Mask, first, normal, plane);
+			bool targetIsBody = false;
+			m_broadPhase.querySwept(swept.entity, BoundingBox(rigidBody.Box, transform.Position), motion, [&](Entity other) {
+				const auto& otherTransform = m_coordinator.getComponent<Components::Transform>(other);
+				const auto& otherBody = m_coordinator.getComponent<Components::RigidBody>(other);
+				/* sensors are passed through, the narrow phase reports them */
+				if (rigidBody.Sensor || otherBody.Sensor) {
+					return;
+				}
+				float t;
+				glm::vec3 n;
+				if (Physics::timeOfImpact(rigidBody.Collider, transform.Position, motion, otherBody.Collider, otherTransform.Position, t, n) && t < first) {
+					first = t;
+					normal = n;
+					target = other;
+					hit = true;
+					targetIsBody = true;
+				}
+			});
+			transform.Position += motion * first;
+			if (!hit) {
+				break;
+			}
 
-	//		auto& meTransform = gCoordinator.getComponent<Components::Transform>(me);
-	//		auto& meBody = gCoordinator.getComponent<Components::RigidBody>(me);
-	//		auto& otherTransform = gCoordinator.getComponent<Components::Transform>(other);
-	//		auto& otherBody = gCoordinator.getComponent<Components::RigidBody>(other);
+			// Exchange momentum along the normal, like the contact solver would have. Planes never move
+			auto* targetBody = targetIsBody ? &m_coordinator.getComponent<Components::RigidBody>(target) : nullptr;
+			const bool targetMoves = targetBody && !targetBody->Anchored;
+			const float invMass = 1.0f / rigidBody.Mass;
+			const float targetInvMass = targetMoves ? 1.0f / targetBody->Mass : 0.0f;
+			const glm::vec3 targetVelocity = targetMoves ? targetBody->Velocity : glm::vec3(0.0f);
+			const float approach = glm::dot(rigidBody.Velocity - targetVelocity, normal);
+			if (approach > 0.0f) {
+				const float restitution = std::min(rigidBody.Restitution, targetBody ? targetBody->Restitution : m_planes.getPlane(plane).Restitution);
+				const float impulse = (1.0f + restitution) * approach / (invMass + targetInvMass);
+				rigidBody.Velocity -= normal * (impulse * invMass);
+				if (targetMoves) {
+					targetBody->Velocity += normal * (impulse * targetInvMass);
+					wake(target);
+				}
+			}
 
-	//		glm::vec meFuturePosition = meTransform.Position + (meBody.Velocity * futureTime);
-	//		glm::vec otherFuturePosition = meTransform.Position + (meBody.Velocity * futureTime);
+			time *= 1.0f - first;
+			motion = rigidBody.Velocity * time;
+		}
 
-	//		BoundingBox meBox = BoundingBox(meBody.Box, meFuturePosition);
-	//		BoundingBox otherBox = BoundingBox(otherBody.Box, otherFuturePosition);
+		// Delete entity if fall out of world
+		if (transform.Position.y < Physics::WORLD_KILL_Y) {
+			removeEntity(swept.entity);
+		}
+	}
+}
 
-	//		if (meBox.overlaps(otherBox)) {
-	//			const glm::vec3 overlap = meBox.overlap(otherBox);
+void PhysicsSystem::removeEntity(Entity entity) {
+	m_entitiesScheduledToRemove.insert(entity);
+}
 
-	//			// correct position
-	//			meTransform.Position -= overlap;
-	//			otherTransform.Position += overlap;
+/* Drops destroyed bodies, adds new ones to the broad phase and gathers the awake bodies. It walks
+   every entity, so it only runs when entities joined or left the system. */
+void PhysicsSystem::syncEntities() {
+	if (m_syncedVersion == m_entitiesVersion) {
+		return;
+	}
+	m_syncedVersion = m_entitiesVersion;
 
-	//		}
-	//	}
+	std::vector<Entity> stale;
+	m_broadPhase.forEachEntity([this, &stale](Entity entity) {
+		if (!m_entities.contains(entity)) {
+			stale.push_back(entity);
+		}
+	});
+	for (Entity entity : stale) {
+		m_broadPhase.remove(entity);
+		m_interpolation.remove(entity);
+		m_surfaces[entity] = false;
+		m_planes.removeBody(entity);
+	}
+
+	for (Entity entity : m_awakeBodies) {
+		m_awake[entity] = false;
+	}
+	m_awakeBodies.clear();
+	m_awakeSorted = true;
+	for (Entity entity : m_entities) {
+		if (m_detached[entity]) {
+			continue;
+		}
+		auto& transform = m_coordinator.getComponent<Components::Transform>(entity);
+		auto& rigidBody = m_coordinator.getComponent<Components::RigidBody>(entity);
+		const bool awake = !rigidBody.Anchored && !rigidBody.Sleeping;
+		if (awake) {
+			m_awake[entity] = true;
+			m_awakeBodies.push_back(entity);
+		}
 
-	//}
+		if (m_broadPhase.contains(entity)) {
+			/* the awake bodies are synced every update */
+			if (!awake) {
+				syncProxy(entity);
+			}
+			continue;
+		}
+		if (std::holds_alternative<std::monostate>(rigidBody.Collider)) {
+			rigidBody.Collider = Physics::Box{ rigidBody.Box.min, rigidBody.Box.max };
+		}
+		/* the box of a terrain or level is all of it, whatever it was given */
+		if (const auto* field = std::get_if<Physics::HeightField>(&rigidBody.Collider)) {
+			rigidBody.Box = field->Data->bounds();
+			m_surfaces[entity] = true;
+		} else if (const auto* level = std::get_if<Physics::Level>(&rigidBody.Collider)) {
+			rigidBody.Box = level->Tree->Bounds;
+			m_surfaces[entity] = true;
+		}
+		m_broadPhase.insert(entity, BoundingBox(rigidBody.Box, transform.Position), rigidBody.Anchored, rigidBody.Layer, rigidBody.Mask);
+		m_interpolation.place(entity, transform.Position, rigidBody.Mass);
+	}
 }
 
-void PhysicsSystem::removeEntity(Entity entity) {
-	m_entitiesScheduledToRemove.insert(entity);
+/* Moves the body's proxy to the tree its Anchored flag asks for, and gives it the body's filter
+   and, if it moves, its box. */
+void PhysicsSystem::syncProxy(Entity entity) {
+	const auto& transform = m_coordinator.getComponent<Components::Transform>(entity);
+	const auto& rigidBody = m_coordinator.getComponent<Components::RigidBody>(entity);
+	const BoundingBox worldBox = BoundingBox(rigidBody.Box, transform.Position);
+	if (m_broadPhase.isStatic(entity) != rigidBody.Anchored) {
+		// Anchored flag was flipped, move the body to the other tree.
+		m_broadPhase.remove(entity);
+		m_broadPhase.insert(entity, worldBox, rigidBody.Anchored, rigidBody.Layer, rigidBody.Mask);
+		return;
+	}
+	if (!m_broadPhase.hasFilter(entity, rigidBody.Layer, rigidBody.Mask)) {
+		m_broadPhase.setFilter(entity, rigidBody.Layer, rigidBody.Mask);
+	}
+	if (!rigidBody.Anchored && !rigidBody.Sleeping) {
+		m_broadPhase.update(entity, worldBox);
+	}
+}
+
+/* Refreshes the proxies of the awake bodies, the others did not move. */
+void PhysicsSystem::syncBroadPhase() {
+	for (Entity entity : m_awakeBodies) {
+		if (!m_detached[entity]) {
+			syncProxy(entity);
+		}
+	}
 }
 
 void PhysicsSystem::update(float deltaTime) {
+	m_contactEvents.clear();
+	m_timings = PhysicsTimings{};
 
 	/* if there are no entities left, exit early */
 	if (m_entities.empty()) {
 		return;
 	}
-	const glm::vec3 gravityDirection = glm::vec3(0.0f, -9.8f, 0.0f);
+
+	/* each phase's time is from the end of the one before */
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point lap = Clock::now();
+	auto endPhase = [&lap](double& phase) {
+		const Clock::time_point now = Clock::now();
+		phase = std::chrono::duration<double, std::milli>(now - lap).count();
+		lap = now;
+	};
 
 	// handle removing entities before iteration
 	for (Entity entity : m_entitiesScheduledToRemove) {
-		m_coordinator.destroyEntity(entity);
+		if (m_detached[entity]) {
+			continue;
+		}
+		m_broadPhase.remove(entity);
+		m_interpolation.remove(entity);
+		m_surfaces[entity] = false;
+		m_planes.removeBody(entity);
+		if (m_deferDestruction) {
+			m_detached[entity] = true;
+			m_detachedEntities.push_back(entity);
+		} else {
+			m_coordinator.destroyEntity(entity);
+		}
 	}
 
 	// remove entities from schedule
 	m_entitiesScheduledToRemove.clear();
 
-	// run future checks
-	future(deltaTime);
+	// Gather the bodies to simulate, from the awake ones in entity order. Away from the viewer only
+	// some of the bodies step each tick, see lod.hpp
+	syncEntities();
+	for (Entity entity : m_activeBodies) {
+		m_solverBodies[entity] = Physics::STATIC_SOLVER_BODY;
+	}
+	m_activeBodies.clear();
+	m_lod.begin(m_lodSettings, deltaTime);
+	if (!m_awakeSorted) {
+		std::sort(m_awakeBodies.begin(), m_awakeBodies.end());
+		m_awakeSorted = true;
+	}
+	for (Entity entity : m_awakeBodies) {
+		const auto& rigidBody = m_coordinator.getComponent<Components::RigidBody>(entity);
+		if (rigidBody.Anchored || rigidBody.Sleeping || m_detached[entity]) {
+			continue;
+		}
+		if (m_lod.add(entity, m_coordinator.getComponent<Components::Transform>(entity).Position) == Physics::LodTier::Near) {
+			m_activeBodies.push_back(entity);
+		}
+	}
+	if (m_lodSettings.Enabled) {
+		// A body touching a near one steps with it, or it would be pushed into like a wall. The
+		// contacts between moving bodies are walked outwards from the near bodies: promoted bodies
+		// are appended to the active ones and walked from in turn, so the whole chain touching a
+		// near one steps.
+		for (size_t i = 0; i < m_activeBodies.size(); i++) {
+			const Entity body = m_activeBodies[i];
+			m_broadPhase.forEachPair(body, [this, body](const Physics::CachedPair& pair) {
+				const Entity other = pair.a == body ? pair.b : pair.a;
+				if (pair.isStatic || pair.contact != Physics::PairContact::Touching || !m_lod.isParked(other)) {
+					return;
+				}
+				const auto& otherBody = m_coordinator.getComponent<Components::RigidBody>(other);
+				if (!otherBody.Anchored && !otherBody.Sleeping) {
+					m_lod.promote(other);
+					m_activeBodies.push_back(other);
+				}
+			});
+		}
+		m_lod.pick(m_activeBodies);
+	}
+	endPhase(m_timings.Setup);
+
+	// Broad phase, only pairs with at least one moving body are generated
+	syncBroadPhase();
+	m_broadPhase.updatePairs();
+	endPhase(m_timings.BroadPhase);
+
+	narrowPhase();
+	collidePlanes();
+	reportContacts();
+	endPhase(m_timings.NarrowPhase);
+
+	// Copy the moving bodies into the integrator. Fast ones are swept instead of moved, see ccd.hpp
+	m_integrator.resize(m_activeBodies.size());
+	for (size_t i = 0; i < m_activeBodies.size(); i++) {
+		const auto& transform = m_coordinator.getComponent<Components::Transform>(m_activeBodies[i]);
+		const auto& rigidBody = m_coordinator.getComponent<Components::RigidBody>(m_activeBodies[i]);
+		const glm::vec3 extent = rigidBody.Box.max - rigidBody.Box.min;
+		const float sweepDistance = rigidBody.Bullet ? -1.0f : Physics::CCD_MOTION_FRACTION * std::min({ extent.x, extent.y, extent.z });
+		m_integrator.set(i, transform.Position, rigidBody.Velocity, rigidBody.Force, 1.0f / rigidBody.Mass, sweepDistance, m_lod.getTimeScale(m_activeBodies[i]));
+	}
 
+	// Apply forces, then let the contacts correct the velocities before moving anything. Gravity
+	// is a force like any other, grounded bodies get it too: the contact holds them up, and
+	// friction needs their weight.
+	m_integrator.integrateVelocities(m_gravity ? glm::vec3(0.0f, -9.8f, 0.0f) : glm::zero<glm::vec3>(), deltaTime);
+	m_solver.begin();
+	for (size_t i = 0; i < m_activeBodies.size(); i++) {
+		m_solverBodies[m_activeBodies[i]] = m_solver.addBody(m_integrator.getVelocity(i), 1.0f / m_coordinator.getComponent<Components::RigidBody>(m_activeBodies[i]).Mass);
+	}
 
-	for (Entity entity : m_entities) {
+	solveContacts(deltaTime);
+	endPhase(m_timings.Solver);
+
+	// Move the bodies. The pseudo velocity only removes penetration, it is not kept
+	for (size_t i = 0; i < m_activeBodies.size(); i++) {
+		const uint32_t body = m_solverBodies[m_activeBodies[i]];
+		m_integrator.setVelocity(i, m_solver.getVelocity(body), m_solver.getPseudoVelocity(body));
+	}
+	m_integrator.integratePositions(deltaTime);
+
+	// Copy the bodies back. Swept ones are moved afterwards, against the others in their new places
+	m_sweptBodies.clear();
+	for (size_t i = 0; i < m_activeBodies.size(); i++) {
+		const Entity entity = m_activeBodies[i];
 		auto& transform = m_coordinator.getComponent<Components::Transform>(entity);
 		auto& rigidBody = m_coordinator.getComponent<Components::RigidBody>(entity);
+		rigidBody.Velocity = m_integrator.getVelocity(i);
+		rigidBody.Force = glm::zero<glm::vec3>();
+		if (m_integrator.isSwept(i)) {
+			m_sweptBodies.push_back(SweptBody{ entity, m_integrator.getMotion(i) });
+			continue;
+		}
+		transform.Position = m_integrator.getPosition(i);
 
-		// Perform movement stuff and make collision checks
-		if (!rigidBody.Anchored) {
-			if (!rigidBody.Anchored) {
-				collision(entity, deltaTime);
-			}
+		// Delete entity if fall out of world
+		if (transform.Position.y < Physics::WORLD_KILL_Y) {
+			removeEntity(entity);
+		}
+	}
+	endPhase(m_timings.Integration);
+	future(deltaTime);
+
+	// Far bodies nobody is near keep going along their velocity, through anything in the way
+	for (Entity entity : m_lod.getKinematic()) {
+		auto& transform = m_coordinator.getComponent<Components::Transform>(entity);
+		transform.Position += m_coordinator.getComponent<Components::RigidBody>(entity).Velocity * deltaTime;
+		if (transform.Position.y < Physics::WORLD_KILL_Y) {
+			removeEntity(entity);
+		}
+	}
 
-			// Gravity stuff
-			if (m_gravity && !rigidBody.onGround) {
-				/* Move our objects downward iff they are not grounded */
-				rigidBody.Force += glm::vec3(0.0f, -9.8f, 0.0f);
+	endPhase(m_timings.Continuous);
+
+	// Sleeping, anchored and parked bodies keep their last position, they are drawn standing still
+	m_interpolation.advance();
+	auto record = [this](Entity entity) {
+		const auto& transform = m_coordinator.getComponent<Components::Transform>(entity);
+		const auto& rigidBody = m_coordinator.getComponent<Components::RigidBody>(entity);
+		m_interpolation.record(entity, transform.Position, rigidBody.Box.overlapping, rigidBody.Mass);
+	};
+	std::for_each(m_activeBodies.begin(), m_activeBodies.end(), record);
+	std::for_each(m_lod.getKinematic().begin(), m_lod.getKinematic().end(), record);
+
+	updateIslands();
+	endPhase(m_timings.Islands);
+}
+
+void PhysicsSystem::wake(Entity entity) {
+	auto& rigidBody = m_coordinator.getComponent<Components::RigidBody>(entity);
+	rigidBody.Sleeping = false;
+	rigidBody.RestingSteps = 0;
+	if (!m_awake[entity]) {
+		m_awake[entity] = true;
+		m_awakeBodies.push_back(entity);
+		m_awakeSorted = false;
+	}
+}
+
+void PhysicsSystem::teleport(Entity entity, glm::vec3 position) {
+	const auto& rigidBody = m_coordinator.getComponent<Components::RigidBody>(entity);
+	m_coordinator.getComponent<Components::Transform>(entity).Position = position;
+	/* syncBroadPhase only refreshes moving bodies, an anchored body would keep its old proxy */
+	if (m_broadPhase.contains(entity)) {
+		m_broadPhase.update(entity, BoundingBox(rigidBody.Box, position));
+	}
+	m_interpolation.place(entity, position, rigidBody.Mass);
+	wake(entity);
+}
+
+void PhysicsSystem::removePlane(uint32_t plane) {
+	m_planes.forEachBody(plane, [this](Entity entity) {
+		if (m_entities.contains(entity) && m_coordinator.getComponent<Components::RigidBody>(entity).Sleeping) {
+			wake(entity);
+		}
+	});
+	m_planes.remove(plane);
+}
+
+/* Destroys the entities removed since the last call. Update must not be running. */
+void PhysicsSystem::destroyDetached() {
+	for (Entity entity : m_detachedEntities) {
+		m_detached[entity] = false;
+		m_coordinator.destroyEntity(entity);
+	}
+	m_detachedEntities.clear();
+}
+
+/* Sets onGround from the contact normals, joins the bodies touching each other into islands and
+   puts islands that have been resting long enough to sleep. An island with a single body awake,
+   e.g. one that just landed on a sleeping pile, wakes up as a whole. Islands are walked from the
+   awake bodies along their contacts, islands with none awake are not looked at. */
+void PhysicsSystem::updateIslands() {
+	const float restingSpeed = m_sleepSettings.LinearVelocity * m_sleepSettings.LinearVelocity;
+	for (Entity entity : m_activeBodies) {
+		auto& rigidBody = m_coordinator.getComponent<Components::RigidBody>(entity);
+		const bool resting = glm::dot(rigidBody.Velocity, rigidBody.Velocity) < restingSpeed;
+		rigidBody.RestingSteps = resting ? rigidBody.RestingSteps + 1 : 0;
+		rigidBody.onGround = false;
+	}
+
+	// The narrow phase went through every pair of the stepping bodies
+	for (const Physics::CachedPair* pair : m_narrowCached) {
+		if (pair->contact != Physics::PairContact::Touching) {
+			continue;
+		}
+		// The normal points from a to b
+		if (pair->manifold.Normal.y < -Physics::GROUND_NORMAL_Y && m_lod.isStepping(pair->a)) {
+			m_coordinator.getComponent<Components::RigidBody>(pair->a).onGround = true;
+		}
+		if (pair->manifold.Normal.y > Physics::GROUND_NORMAL_Y && m_lod.isStepping(pair->b)) {
+			m_coordinator.getComponent<Components::RigidBody>(pair->b).onGround = true;
+		}
+	}
+
+	for (const Physics::PlaneContact& contact : m_planes.getContacts()) {
+		auto& rigidBody = m_coordinator.getComponent<Components::RigidBody>(contact.body);
+		if (contact.manifold->PointCount > 0 && contact.manifold->Normal.y < -Physics::GROUND_NORMAL_Y) {
+			rigidBody.onGround = true;
+		}
+	}
+
+	// A body that lost a contact to a removed body may be left hanging in the air
+	for (const Physics::PairEvent& event : m_broadPhase.getPairEvents()) {
+		if (event.type != Physics::PairEventType::End) {
+			continue;
+		}
+		for (Entity entity : { event.a, event.b }) {
+			if (m_entities.contains(entity) && m_coordinator.getComponent<Components::RigidBody>(entity).Sleeping) {
+				wake(entity);
 			}
+		}
+	}
 
-			// Update accel.
-			rigidBody.Velocity += rigidBody.Force / rigidBody.Mass * deltaTime;
+	if (m_sleepSettings.Enabled) {
+		auto inIsland = [this](Entity entity) {
+			const uint32_t node = m_islandNodes[entity];
+			return node < m_islandBodies.size() && m_islandBodies[node] == entity;
+		};
+		auto addToIsland = [this](Entity entity) {
+			m_islandNodes[entity] = static_cast<uint32_t>(m_islandBodies.size());
+			m_islandBodies.push_back(entity);
+		};
+		m_islandBodies.clear();
+		// Bodies woken on the way are appended to the awake ones, they are in an island by then
+		for (size_t seed = 0; seed < m_awakeBodies.size(); seed++) {
+			const Entity entity = m_awakeBodies[seed];
+			if (m_detached[entity] || inIsland(entity)) {
+				continue;
+			}
+			const auto& seedBody = m_coordinator.getComponent<Components::RigidBody>(entity);
+			if (seedBody.Anchored || seedBody.Sleeping) {
+				continue;
+			}
 
-			// Update pos./vel.
-			transform.Position += rigidBody.Velocity * deltaTime;
+			// The island goes as far as the contacts between moving bodies. Anchored bodies do
+			// not join islands, or everything on the ground would be one island
+			const size_t first = m_islandBodies.size();
+			uint32_t resting = UINT32_MAX;
+			addToIsland(entity);
+			for (size_t node = first; node < m_islandBodies.size(); node++) {
+				const Entity body = m_islandBodies[node];
+				const auto& rigidBody = m_coordinator.getComponent<Components::RigidBody>(body);
+				resting = std::min(resting, rigidBody.Sleeping ? UINT32_MAX : rigidBody.RestingSteps);
+				m_broadPhase.forEachPair(body, [&](const Physics::CachedPair& pair) {
+					const Entity other = pair.a == body ? pair.b : pair.a;
+					if (!pair.isStatic && pair.contact == Physics::PairContact::Touching && !inIsland(other)) {
+						addToIsland(other);
+					}
+				});
+			}
 
-			// Zero out the force
-			rigidBody.Force = glm::zero<glm::vec3>();
+			const bool sleep = resting >= m_sleepSettings.Steps;
+			for (size_t node = first; node < m_islandBodies.size(); node++) {
+				const Entity body = m_islandBodies[node];
+				auto& rigidBody = m_coordinator.getComponent<Components::RigidBody>(body);
+				if (sleep && !rigidBody.Sleeping) {
+					rigidBody.Sleeping = true;
+					rigidBody.Velocity = glm::zero<glm::vec3>();
+				} else if (!sleep && rigidBody.Sleeping) {
+					wake(body);
+				}
+			}
+		}
+	}
 
-			// Delete entity if fall out of world
-			if (transform.Position.y < -100.0f) {
-				removeEntity(entity);
+	// Bodies that fell asleep, were anchored or were removed are no longer awake
+	std::erase_if(m_awakeBodies, [this](Entity entity) {
+		if (!m_detached[entity]) {
+			const auto& rigidBody = m_coordinator.getComponent<Components::RigidBody>(entity);
+			if (!rigidBody.Anchored && !rigidBody.Sleeping) {
+				return false;
 			}
 		}
+		m_awake[entity] = false;
+		return true;
+	});
+}
+
+Physics::RayHit PhysicsSystem::raycast(const Physics::Ray& ray) const {
+	Physics::RayHit hit{};
+	raycastBatch(std::span<const Physics::Ray>(&ray, 1), std::span<Physics::RayHit>(&hit, 1));
+	return hit;
+}
+
+// Runs query(trees, first, count) over packets of at most RAY_PACKET_SIZE items in parallel.
+template<class Query>
+void PhysicsSystem::forEachPacket(size_t count, Query&& query) const {
+	const size_t packets = (count + Physics::RAY_PACKET_SIZE - 1) / Physics::RAY_PACKET_SIZE;
+	if (packets <= 1) {
+		if (packets == 1) {
+			query(0, count);
+		}
+		return;
 	}
+	if (m_packets.size() < packets) {
+		m_packets.resize(packets);
+		std::iota(m_packets.begin(), m_packets.end(), 0);
+	}
+	std::for_each(std::execution::par, m_packets.begin(), m_packets.begin() + packets, [&](size_t packet) {
+		const size_t first = packet * Physics::RAY_PACKET_SIZE;
+		query(first, std::min(Physics::RAY_PACKET_SIZE, count - first));
+	});
+}
+
+namespace {
+	/* Traces rays reaching the box of a terrain through its grid, and of a level through its BSP tree. */
+	class SurfaceRaycast : public Physics::ExactRaycast {
+	public:
+		SurfaceRaycast(Coordinator& coordinator, const std::vector<bool>& surfaces) :
+			m_coordinator(coordinator),
+			m_surfaces(surfaces) { }
+
+		bool covers(Entity entity) const override {
+			return m_surfaces[entity];
+		}
+
+		bool raycast(Entity entity, glm::vec3 origin, glm::vec3 direction, float maxDistance, float& t, glm::vec3& normal) const override {
+			const auto& position = m_coordinator.getComponent<Components::Transform>(entity).Position;
+			const auto& collider = m_coordinator.getComponent<Components::RigidBody>(entity).Collider;
+			if (const auto* field = std::get_if<Physics::HeightField>(&collider)) {
+				return field->Data->raycast(origin - position, direction, maxDistance, t, normal);
+			}
+			return std::get<Physics::Level>(collider).Tree->raycast(origin - position, direction, maxDistance, t, normal);
+		}
+	private:
+		Coordinator& m_coordinator;
+		const std::vector<bool>& m_surfaces;
+	};
+}
+
+void PhysicsSystem::raycastBatch(std::span<const Physics::Ray> rays, std::span<Physics::RayHit> hits) const {
+	const Physics::AABBTree* trees[] = { &m_broadPhase.getStaticTree(), &m_broadPhase.getDynamicTree() };
+	const SurfaceRaycast exact(m_coordinator, m_surfaces);
+	forEachPacket(std::min(rays.size(), hits.size()), [&](size_t first, size_t count) {
+		Physics::raycastPacket(trees, rays.subspan(first, count), hits.subspan(first, count), &exact);
+	});
+}
+
+void PhysicsSystem::shapecastBatch(std::span<const Physics::ShapeCast> casts, std::span<Physics::RayHit> hits) const {
+	const Physics::AABBTree* trees[] = { &m_broadPhase.getStaticTree(), &m_broadPhase.getDynamicTree() };
+	forEachPacket(std::min(casts.size(), hits.size()), [&](size_t first, size_t count) {
+		Physics::shapecastPacket(trees, casts.subspan(first, count), hits.subspan(first, count));
+	});
+}
+
+size_t PhysicsSystem::overlapAABB(const Physics::BoxOverlap& query, std::span<Entity> results) const {
+	const Physics::AABBTree* trees[] = { &m_broadPhase.getStaticTree(), &m_broadPhase.getDynamicTree() };
+	return Physics::overlapAABB(trees, query, results);
+}
+
+size_t PhysicsSystem::overlapSphere(const Physics::SphereOverlap& query, std::span<Entity> results) const {
+	const Physics::AABBTree* trees[] = { &m_broadPhase.getStaticTree(), &m_broadPhase.getDynamicTree() };
+	return Physics::overlapSphere(trees, query, results);
+}
+
+size_t PhysicsSystem::overlapAABBBatch(std::span<const Physics::BoxOverlap> queries, std::span<Entity> results, std::span<Physics::OverlapRange> ranges) const {
+	const Physics::AABBTree* trees[] = { &m_broadPhase.getStaticTree(), &m_broadPhase.getDynamicTree() };
+	return Physics::overlapAABBBatch(trees, queries, results, ranges);
+}
+
+size_t PhysicsSystem::overlapSphereBatch(std::span<const Physics::SphereOverlap> queries, std::span<Entity> results, std::span<Physics::OverlapRange> ranges) const {
+	const Physics::AABBTree* trees[] = { &m_broadPhase.getStaticTree(), &m_broadPhase.getDynamicTree() };
+	return Physics::overlapSphereBatch(trees, queries, results, ranges);
 }
\ No newline at end of file
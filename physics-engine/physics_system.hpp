@@ -1,23 +1,177 @@
 #pragma once
 #include "systems.hpp"
 #include "octree.hpp"
+#include "broad_phase.hpp"
+#include "scene_query.hpp"
+#include "narrow_phase.hpp"
+#include "contact_solver.hpp"
+#include "island.hpp"
+#include "ccd.hpp"
+#include "interpolation.hpp"
+#include "integrator.hpp"
+#include "plane_contacts.hpp"
+#include "lod.hpp"
+#include "contact_events.hpp"
+#include "components.hpp"
 
 namespace Systems {
+	/* Wall time of the phases of an update, in milliseconds. */
+	struct PhysicsTimings {
+		/* Removing and adding bodies, and gathering the ones to simulate. */
+		double Setup = 0.0;
+		double BroadPhase = 0.0;
+		/* Pairs, planes and contact events. */
+		double NarrowPhase = 0.0;
+		/* Forces and contacts. */
+		double Solver = 0.0;
+		double Integration = 0.0;
+		double Continuous = 0.0;
+		/* Interpolation, islands and sleeping. */
+		double Islands = 0.0;
+	};
+
 	class PhysicsSystem : public System {
 	public:
 		PhysicsSystem(Coordinator& c) :
 			System(c),
 			m_gravity(true),
-			m_entitiesScheduledToRemove() { }
+			m_entitiesScheduledToRemove(),
+			m_broadPhase(),
+			m_touchingPairs(MAX_ENTITIES, 0),
+			m_solverBodies(MAX_ENTITIES, Physics::STATIC_SOLVER_BODY),
+			m_awake(MAX_ENTITIES, false),
+			m_islandNodes(MAX_ENTITIES),
+			m_detached(MAX_ENTITIES, false),
+			m_surfaces(MAX_ENTITIES, false) { }
 	public:
 		void init();
 		void update(float deltaTime) override;
-		void collision(Entity base, float deltaTime);
 		void switchGravity();
 		void removeEntity(Entity entity);
+		/* Continuous collision for the bodies of this step too fast to simply be moved, see ccd.hpp. */
 		void future(float futureTime);
+		/* Wakes a sleeping body. Its island follows in the next update. Sleeping and anchored bodies
+		   are not looked at until something touches them, so a body given a force, a velocity, an
+		   Anchored flag, a layer or a mask from outside must be woken for it to be seen. */
+		void wake(Entity entity);
+		/* Moves a body without it passing through the space in between, and wakes it. Anchored bodies
+		   must be moved this way, their broad phase proxies are not refreshed otherwise. */
+		void teleport(Entity entity, glm::vec3 position);
+
+		/* Static planes, e.g. the ground. They are not bodies: every moving body is tested against
+		   all of them in a pass of their own, see plane_contacts.hpp. Removing a plane wakes the
+		   bodies resting on it. */
+		uint32_t addPlane(const Physics::StaticPlane& plane) { return m_planes.add(plane); }
+		void removePlane(uint32_t plane);
+
+		/* With deferred destruction, removed entities are only taken out of the simulation and left
+		   for destroyDetached(), for when the coordinator must not change during update (i.e. update
+		   runs on another thread than the one reading the coordinator). */
+		void setDeferredDestruction(bool deferred) { m_deferDestruction = deferred; }
+		bool hasDetached() const { return !m_detachedEntities.empty(); }
+		void destroyDetached();
+
+		const Physics::SolverSettings& getSolverSettings() const { return m_solverSettings; }
+		void setSolverSettings(const Physics::SolverSettings& settings) { m_solverSettings = settings; }
+		const Physics::SleepSettings& getSleepSettings() const { return m_sleepSettings; }
+		void setSleepSettings(const Physics::SleepSettings& settings) { m_sleepSettings = settings; }
+		const Physics::LodSettings& getLodSettings() const { return m_lodSettings; }
+		void setLodSettings(const Physics::LodSettings& settings) { m_lodSettings = settings; }
+
+		/* Bodies far from the viewer and the points of interest are stepped less often, see lod.hpp. */
+		void setViewer(glm::vec3 position) { m_lod.setViewer(position); }
+		void setPointsOfInterest(std::vector<glm::vec3> points) { m_lod.setPointsOfInterest(std::move(points)); }
+
+		/* Positions of the bodies at the last two updates, for drawing them in between. Bodies are
+		   in it from their first update on. */
+		const Physics::InterpolationBuffer& getInterpolation() const { return m_interpolation; }
+
+		/* Pairs that started or stopped overlapping during the last update. */
+		const std::vector<Physics::PairEvent>& getPairEvents() const { return m_broadPhase.getPairEvents(); }
+		/* Contacts and sensor overlaps that began, went on or ended during the last update, see
+		   contact_events.hpp. Read them between updates, the next one starts over. */
+		const Physics::ContactEventBuffer& getContactEvents() const { return m_contactEvents; }
+		/* Persist events are only reported when asked for, see ContactEventBuffer::setPersist. */
+		void setPersistEvents(bool persist) { m_contactEvents.setPersist(persist); }
+		/* Where the last update spent its time. */
+		const PhysicsTimings& getTimings() const { return m_timings; }
+
+		/* Scene queries against the broad phase as of the last update. The batched versions write
+		   hits[i] for rays[i], split the rays into packets and trace the packets in parallel. Rays
+		   hit terrain and level bodies on their surface, everything else on its box. Batches share
+		   their packet list, so one batch runs at a time. */
+		Physics::RayHit raycast(const Physics::Ray& ray) const;
+		void raycastBatch(std::span<const Physics::Ray> rays, std::span<Physics::RayHit> hits) const;
+		void shapecastBatch(std::span<const Physics::ShapeCast> casts, std::span<Physics::RayHit> hits) const;
+
+		/* Region queries. They write the bodies found into results and return how many were written,
+		   see scene_query.hpp. */
+		size_t overlapAABB(const Physics::BoxOverlap& query, std::span<Entity> results) const;
+		size_t overlapSphere(const Physics::SphereOverlap& query, std::span<Entity> results) const;
+		size_t overlapAABBBatch(std::span<const Physics::BoxOverlap> queries, std::span<Entity> results, std::span<Physics::OverlapRange> ranges) const;
+		size_t overlapSphereBatch(std::span<const Physics::SphereOverlap> queries, std::span<Entity> results, std::span<Physics::OverlapRange> ranges) const;
+	private:
+		void syncEntities();
+		void syncProxy(Entity entity);
+		void syncBroadPhase();
+		void narrowPhase();
+		void collidePlanes();
+		void reportContacts();
+		void solveContacts(float deltaTime);
+		void updateIslands();
+		template<class Query>
+		void forEachPacket(size_t count, Query&& query) const;
 	private:
 		bool m_gravity{true};
 		std::set<Entity> m_entitiesScheduledToRemove{};
+		Physics::BroadPhase m_broadPhase;
+		Physics::NarrowPhase m_narrowPhase;
+		Physics::PlaneContacts m_planes;
+		Physics::ContactEventBuffer m_contactEvents;
+		PhysicsTimings m_timings{};
+		/* Narrow phase buffers, index i of each belongs to the same pair. Kept between updates. */
+		std::vector<Physics::CachedPair*> m_narrowCached{};
+		std::vector<Physics::NarrowPhasePair> m_narrowPairs{};
+		std::vector<Physics::NarrowPhaseResult> m_narrowResults{};
+		/* Pairs of each body that touch or trigger, its box is flagged overlapping while it has any. */
+		std::vector<uint32_t> m_touchingPairs;
+		Physics::ContactSolver m_solver;
+		Physics::SolverSettings m_solverSettings{};
+		/* Index of each entity's body in the solver, valid during update. */
+		std::vector<uint32_t> m_solverBodies;
+		Physics::LodScheduler m_lod;
+		Physics::LodSettings m_lodSettings{};
+		/* Bodies that are neither anchored nor asleep, and the ones woken since the last update,
+		   flagged per entity and listed in entity order while m_awakeSorted. The list is only
+		   rebuilt from every entity when entities joined or left, m_syncedVersion is the
+		   m_entitiesVersion it was rebuilt at. */
+		std::vector<bool> m_awake;
+		std::vector<Entity> m_awakeBodies{};
+		bool m_awakeSorted{true};
+		uint32_t m_syncedVersion{0};
+		/* Bodies that are neither anchored, asleep nor parked by the LOD, gathered at the start of update. */
+		std::vector<Entity> m_activeBodies{};
+		/* The active bodies during update, body i is m_activeBodies[i]. */
+		Physics::Integrator m_integrator;
+		Physics::SleepSettings m_sleepSettings{};
+		/* Index of each body in m_islandBodies, the bodies of the islands walked by updateIslands
+		   one island after another. */
+		std::vector<uint32_t> m_islandNodes;
+		std::vector<Entity> m_islandBodies{};
+		/* Bodies left to future() this step, with the motion they were not moved by. */
+		struct SweptBody {
+			Entity entity;
+			glm::vec3 motion;
+		};
+		std::vector<SweptBody> m_sweptBodies{};
+		Physics::InterpolationBuffer m_interpolation;
+		bool m_deferDestruction{false};
+		/* Removed entities waiting for destroyDetached(), flagged per entity so update can skip them. */
+		std::vector<bool> m_detached;
+		std::vector<Entity> m_detachedEntities{};
+		/* Bodies in the broad phase with a HeightField or Level collider, raycast against their surface. */
+		std::vector<bool> m_surfaces;
+		/* 0, 1, 2, ... for the packets of batched queries, kept so that a batch does not allocate. */
+		mutable std::vector<size_t> m_packets{};
 	};
-}
\ No newline at end of file
+}
@@ -1,16 +1,15 @@
 #include "plane.hpp"
+#include <cmath>
 
-bool Plane::intersects(glm::vec3 a, glm::vec3 b) {
-	float dot = glm::dot(b - a, m_normal);
-	return dot != 0.0f;
+bool Plane::intersects(glm::vec3 a, glm::vec3 b) const {
+	return distance(a) * distance(b) <= 0.0f;
 }
 
-bool Plane::intersects(const BoundingBox& _box, const glm::vec3 position) {
+bool Plane::intersects(const BoundingBox& _box, const glm::vec3 position) const {
 	const BoundingBox box = BoundingBox(_box, position);
-	return intersects(glm::vec3(box.min), glm::vec3(box.min.x, box.min.y, box.max.x))
-		|| intersects(glm::vec3(box.min), glm::vec3(box.min.x, box.max.y, box.min.z))
-		|| intersects(glm::vec3(box.min), glm::vec3(box.max.x, box.min.y, box.min.z))
-		|| intersects(glm::vec3(box.max), glm::vec3(box.min.x, box.max.y, box.max.z))
-		|| intersects(glm::vec3(box.max), glm::vec3(box.max.x, box.min.y, box.max.z))
-		|| intersects(glm::vec3(box.max), glm::vec3(box.max.x, box.min.y, box.min.z));
+	const glm::vec3 center = (box.min + box.max) * 0.5f;
+	const glm::vec3 extent = (box.max - box.min) * 0.5f;
+	/* how far the corners reach along the normal, either way from the center */
+	const float radius = glm::dot(extent, glm::abs(m_normal));
+	return std::abs(distance(center)) <= radius;
 }
@@ -1,6 +1,13 @@
+#pragma once
 #include "glm/glm.hpp"
 #include "box.hpp"
 
+/*
+* 
+* The plane of points p with dot(m_normal, p) == dist. m_normal must be normalized; the side it
+* points to is the front of the plane.
+* 
+*/
 struct Plane {
 	
 	float dist;
@@ -11,8 +18,15 @@ struct Plane {
 
 	Plane(const Plane& plane) : dist(plane.dist), m_normal(plane.m_normal) {}
 
+	Plane& operator=(const Plane& plane) = default;
+
 	~Plane() = default;
 
-	bool intersects(glm::vec3 pointA, glm::vec3 pointB);
-	bool intersects(const BoundingBox& box, const glm::vec3 position);
+	/* Signed distance of the point to the plane, positive in front of it. */
+	float distance(glm::vec3 point) const { return glm::dot(m_normal, point) - dist; }
+
+	/* Whether the segment between the points touches the plane. */
+	bool intersects(glm::vec3 pointA, glm::vec3 pointB) const;
+	/* Whether the box, moved to position, has corners on both sides of the plane or touches it. */
+	bool intersects(const BoundingBox& box, const glm::vec3 position) const;
 };
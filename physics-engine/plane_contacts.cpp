@@ -0,0 +1,266 @@
+#include "plane_contacts.hpp"
+#include "ccd.hpp"
+#include "simd.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace Physics;
+
+namespace {
+	using namespace Physics::Simd;
+
+	constexpr size_t LANES = width<FloatN>;
+
+	// touching = 1 where the box reaches to within PLANE_CONTACT_MARGIN of the plane's front, and
+	// for a bounded plane overlaps its bounds.
+	template<class V>
+	void touchLanes(const float* cx, const float* cy, const float* cz, const float* ex, const float* ey, const float* ez, float* touching, const StaticPlane& plane) {
+		const glm::vec3 n = plane.Surface.m_normal;
+		const V x = load<V>(cx);
+		const V y = load<V>(cy);
+		const V z = load<V>(cz);
+		const V hx = load<V>(ex);
+		const V hy = load<V>(ey);
+		const V hz = load<V>(ez);
+		// Distance of the box's lowest corner, the center's distance less how far the box reaches back
+		const V reach = splat<V>(std::fabs(n.x)) * hx + splat<V>(std::fabs(n.y)) * hy + splat<V>(std::fabs(n.z)) * hz;
+		const V separation = splat<V>(n.x) * x + splat<V>(n.y) * y + splat<V>(n.z) * z - splat<V>(plane.Surface.dist) - reach;
+		auto touch = separation <= splat<V>(PLANE_CONTACT_MARGIN);
+		if (plane.Bounded) {
+			const BoundingBox& bounds = plane.Bounds;
+			touch = touch
+				& (x + hx >= splat<V>(bounds.min.x)) & (x - hx <= splat<V>(bounds.max.x))
+				& (y + hy >= splat<V>(bounds.min.y)) & (y - hy <= splat<V>(bounds.max.y))
+				& (z + hz >= splat<V>(bounds.min.z)) & (z - hz <= splat<V>(bounds.max.z));
+		}
+		store(touching, maskToFloat(touch));
+	}
+
+	// The points of a convex shape that can be the deepest behind a plane, in local space, and
+	// the radius the shape reaches around them. Concave shapes are static and have none.
+	float featurePoints(const ColliderShape& collider, std::vector<glm::vec3>& points) {
+		points.clear();
+		if (const auto* sphere = std::get_if<Sphere>(&collider)) {
+			points.push_back(glm::vec3(0.0f));
+			return sphere->Radius;
+		}
+		if (const auto* capsule = std::get_if<Capsule>(&collider)) {
+			points.push_back(glm::vec3(0.0f, -capsule->HalfHeight, 0.0f));
+			points.push_back(glm::vec3(0.0f, capsule->HalfHeight, 0.0f));
+			return capsule->Radius;
+		}
+		if (const auto* box = std::get_if<Box>(&collider)) {
+			for (int corner = 0; corner < 8; corner++) {
+				points.push_back(glm::vec3(
+					corner & 1 ? box->Max.x : box->Min.x,
+					corner & 2 ? box->Max.y : box->Min.y,
+					corner & 4 ? box->Max.z : box->Min.z));
+			}
+			return 0.0f;
+		}
+		if (const auto* hull = std::get_if<ConvexHull>(&collider)) {
+			points.assign(hull->Mesh->Vertices.begin(), hull->Mesh->Vertices.end());
+		}
+		return 0.0f;
+	}
+
+	// Whether a point on the surface of a bounded plane is on its patch.
+	bool onPatch(const StaticPlane& plane, glm::vec3 point) {
+		if (!plane.Bounded) {
+			return true;
+		}
+		const BoundingBox& bounds = plane.Bounds;
+		return glm::all(glm::greaterThanEqual(point, bounds.min - PLANE_CONTACT_MARGIN))
+			&& glm::all(glm::lessThanEqual(point, bounds.max + PLANE_CONTACT_MARGIN));
+	}
+}
+
+uint32_t PlaneContacts::add(const StaticPlane& plane) {
+	uint32_t id;
+	if (!m_freePlanes.empty()) {
+		id = m_freePlanes.back();
+		m_freePlanes.pop_back();
+	} else {
+		id = static_cast<uint32_t>(m_planes.size());
+		m_planes.emplace_back();
+	}
+	m_planes[id].plane = plane;
+	m_planes[id].live = true;
+	m_planeCount++;
+	return id;
+}
+
+void PlaneContacts::remove(uint32_t plane) {
+	if (plane >= m_planes.size() || !m_planes[plane].live) {
+		return;
+	}
+	m_planes[plane].live = false;
+	for (const auto& [entity, touch] : m_planes[plane].touches) {
+		m_endedPending.push_back(PlaneContact{ entity, plane, nullptr });
+	}
+	m_planes[plane].touches.clear();
+	m_freePlanes.push_back(plane);
+	m_planeCount--;
+	// Their manifolds are gone
+	m_contacts.clear();
+}
+
+void PlaneContacts::resize(size_t count) {
+	m_count = count;
+	m_step++;
+	m_bodies.resize(count);
+	const size_t padded = (count + LANES - 1) / LANES * LANES;
+	for (std::vector<float>* array : { &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ, &m_touching }) {
+		array->assign(padded, 0.0f);
+	}
+}
+
+void PlaneContacts::set(size_t body, Entity entity, glm::vec3 position, const BoundingBox& box, const ColliderShape& collider, CollisionLayer layer, CollisionLayer mask) {
+	const glm::vec3 center = (box.min + box.max) * 0.5f;
+	const glm::vec3 extent = (box.max - box.min) * 0.5f;
+	m_centerX[body] = center.x;
+	m_centerY[body] = center.y;
+	m_centerZ[body] = center.z;
+	m_extentX[body] = extent.x;
+	m_extentY[body] = extent.y;
+	m_extentZ[body] = extent.z;
+	m_bodies[body] = Body{ entity, position, &collider, layer, mask };
+	m_bodyStep[entity] = m_step;
+}
+
+void PlaneContacts::collide() {
+	std::swap(m_previous, m_contacts);
+	m_contacts.clear();
+	std::swap(m_ended, m_endedPending);
+	m_endedPending.clear();
+
+	for (uint32_t plane = 0; plane < m_planes.size(); plane++) {
+		const Slot& slot = m_planes[plane];
+		if (!slot.live) {
+			continue;
+		}
+		for (size_t i = 0; i < m_touching.size(); i += LANES) {
+			touchLanes<FloatN>(&m_centerX[i], &m_centerY[i], &m_centerZ[i], &m_extentX[i], &m_extentY[i], &m_extentZ[i], &m_touching[i], slot.plane);
+		}
+		// The padding past m_count is never looked at
+		for (size_t body = 0; body < m_count; body++) {
+			if (m_touching[body] != 0.0f) {
+				collideBody(plane, m_bodies[body]);
+			}
+		}
+	}
+
+	// Bodies of this step that touched a plane last step but not this one
+	for (const PlaneContact& contact : m_previous) {
+		Slot& slot = m_planes[contact.plane];
+		if (!slot.live || m_bodyStep[contact.body] != m_step) {
+			continue;
+		}
+		const auto touch = slot.touches.find(contact.body);
+		if (touch != slot.touches.end() && touch->second.step != m_step) {
+			slot.touches.erase(touch);
+			m_ended.push_back(PlaneContact{ contact.body, contact.plane, nullptr });
+		}
+	}
+}
+
+void PlaneContacts::collideBody(uint32_t plane, const Body& body) {
+	Slot& slot = m_planes[plane];
+	const StaticPlane& surface = slot.plane;
+	if (!shouldCollide(body.layer, body.mask, surface.Layer, surface.Mask)) {
+		return;
+	}
+	const glm::vec3 n = surface.Surface.m_normal;
+	const float radius = featurePoints(*body.collider, m_points);
+
+	m_found.clear();
+	for (uint32_t k = 0; k < m_points.size(); k++) {
+		const glm::vec3 world = body.position + m_points[k];
+		const float separation = surface.Surface.distance(world) - radius;
+		if (separation > PLANE_CONTACT_MARGIN) {
+			continue;
+		}
+		const glm::vec3 onSurface = world - n * (separation + radius);
+		if (!onPatch(surface, onSurface)) {
+			continue;
+		}
+		ContactPoint point{};
+		point.LocalA = m_points[k] - n * radius;
+		point.LocalB = onSurface;
+		point.Depth = -separation;
+		point.Id = k;
+		m_found.push_back(point);
+	}
+	if (m_found.empty()) {
+		return;
+	}
+
+	ContactManifold fresh{};
+	fresh.Normal = -n;
+	fresh.PointCount = reduceContacts(m_found.data(), static_cast<uint32_t>(m_found.size()));
+	std::copy(m_found.begin(), m_found.begin() + fresh.PointCount, fresh.Points.begin());
+
+	const auto [found, began] = slot.touches.try_emplace(body.entity);
+	Touch& touch = found->second;
+	touch.manifold.merge(fresh, body.position, glm::vec3(0.0f), false);
+	touch.step = m_step;
+	m_contacts.push_back(PlaneContact{ body.entity, plane, &touch.manifold, began });
+}
+
+void PlaneContacts::removeBody(Entity entity) {
+	for (uint32_t plane = 0; plane < m_planes.size(); plane++) {
+		if (m_planes[plane].touches.erase(entity) > 0) {
+			m_endedPending.push_back(PlaneContact{ entity, plane, nullptr });
+		}
+	}
+	std::erase_if(m_contacts, [entity](const PlaneContact& contact) { return contact.body == entity; });
+}
+
+// The deepest point of a convex shape moves towards the plane at a constant rate, so the time
+// it reaches the surface is found directly, without bisecting.
+bool PlaneContacts::timeOfImpact(const ColliderShape& shape, glm::vec3 position, glm::vec3 motion, CollisionLayer layer, CollisionLayer mask, float& t, glm::vec3& normal, uint32_t& plane) const {
+	bool hit = false;
+	float first = 1.0f;
+	for (uint32_t id = 0; id < m_planes.size(); id++) {
+		const StaticPlane& surface = m_planes[id].plane;
+		if (!m_planes[id].live || !shouldCollide(layer, mask, surface.Layer, surface.Mask)) {
+			continue;
+		}
+		const glm::vec3 n = surface.Surface.m_normal;
+		const float approach = -glm::dot(n, motion);
+		if (approach <= 0.0f) {
+			continue;
+		}
+		glm::vec3 deepest;
+		const bool convex = std::visit([&](const auto& s) {
+			using T = std::decay_t<decltype(s)>;
+			if constexpr (std::is_same_v<T, std::monostate> || isConcave<T>) {
+				return false;
+			} else {
+				deepest = position + s.support(-n);
+				return true;
+			}
+		}, shape);
+		if (!convex) {
+			return false;
+		}
+		// Already touching is left to the contact solver
+		const float separation = surface.Surface.distance(deepest);
+		if (separation <= 0.0f || separation >= approach) {
+			continue;
+		}
+		const float reached = separation / approach;
+		if (reached >= first || !onPatch(surface, deepest + motion * reached)) {
+			continue;
+		}
+		first = reached;
+		normal = -n;
+		plane = id;
+		hit = true;
+	}
+	if (hit) {
+		// Stop short of the surface, like the bisection does
+		t = std::max(0.0f, first - CCD_TOLERANCE / glm::length(motion));
+	}
+	return hit;
+}
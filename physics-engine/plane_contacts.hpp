@@ -0,0 +1,134 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "types.hpp"
+#include "box.hpp"
+#include "plane.hpp"
+#include "manifold.hpp"
+#include "collider.hpp"
+#include "collision_filter.hpp"
+
+namespace Physics {
+
+	// Bodies this close in front of a plane get contact points already, so that a resting contact
+	// keeps its impulses from step to step instead of coming and going.
+	constexpr float PLANE_CONTACT_MARGIN = CONTACT_BREAK_DISTANCE;
+
+	// A static plane collider. Everything behind the plane is solid, so an infinite plane is a
+	// half-space. A bounded plane is only solid within Bounds, a world box around the patch and
+	// the slab behind it: bodies whose box is outside it pass by, and points whose contact on the
+	// surface is outside it do not touch.
+	struct StaticPlane {
+		Plane Surface;
+		bool Bounded = false;
+		BoundingBox Bounds;
+		float Restitution = 0.0f;
+		float Friction = 0.5f;
+		CollisionLayer Layer = Layers::Static;
+		CollisionLayer Mask = Layers::All;
+	};
+
+	// A body touching a plane. The manifold's normal points from the body into the plane, and its
+	// LocalB are the contact points on the surface in world space.
+	struct PlaneContact {
+		Entity body;
+		uint32_t plane;
+		ContactManifold* manifold;
+		// The body did not touch the plane before this step.
+		bool began = false;
+	};
+
+	// The static planes of the world, kept out of the broad phase and its pairs. Ground contacts
+	// are the most common ones, so every step the moving bodies are tested against all planes in
+	// one pass: their world boxes are stored structure-of-arrays like in the integrator, and each
+	// plane goes over them a SIMD register at a time. Only the bodies whose box reaches a plane are
+	// then tested point by point. Manifolds are kept per plane and body between steps.
+	class PlaneContacts {
+	public:
+		PlaneContacts() : m_bodyStep(MAX_ENTITIES, 0) { }
+
+		// Ids of removed planes are given out again.
+		uint32_t add(const StaticPlane& plane);
+		void remove(uint32_t plane);
+		bool empty() const { return m_planeCount == 0; }
+		const StaticPlane& getPlane(uint32_t plane) const { return m_planes[plane].plane; }
+		// Calls visit(entity) for every body with a manifold against the plane, asleep or not.
+		template<class Visit>
+		void forEachBody(uint32_t plane, Visit&& visit) const {
+			for (const auto& [entity, touch] : m_planes[plane].touches) {
+				visit(entity);
+			}
+		}
+
+		// Makes room for count bodies, dropping the previous step's.
+		void resize(size_t count);
+		size_t size() const { return m_count; }
+		// box is the body's box in world space. The collider must stay alive until collide returns.
+		void set(size_t body, Entity entity, glm::vec3 position, const BoundingBox& box, const ColliderShape& collider, CollisionLayer layer, CollisionLayer mask);
+		// Tests the bodies against every plane and updates their manifolds. Bodies of this step that
+		// stopped touching a plane lose their manifold, bodies not in it (asleep) keep theirs.
+		void collide();
+		// The bodies of the last collide touching a plane, in the order of the planes, then of the bodies.
+		const std::vector<PlaneContact>& getContacts() const { return m_contacts; }
+		// Forgets the body's manifolds, for bodies leaving the simulation.
+		void removeBody(Entity entity);
+		// Bodies and planes that stopped touching in the last collide, or by the body or the plane
+		// being removed before it. Their manifold is null.
+		const std::vector<PlaneContact>& getEnded() const { return m_ended; }
+
+		// First time of impact in [0, 1] of a convex shape moved by motion against any plane, like
+		// Physics::timeOfImpact. normal points from the shape into the plane that is hit. t, normal
+		// and plane are only written on a hit.
+		bool timeOfImpact(const ColliderShape& shape, glm::vec3 position, glm::vec3 motion, CollisionLayer layer, CollisionLayer mask, float& t, glm::vec3& normal, uint32_t& plane) const;
+	private:
+		struct Touch {
+			ContactManifold manifold;
+			// The last step the body touched the plane.
+			uint32_t step;
+		};
+		struct Slot {
+			StaticPlane plane;
+			bool live;
+			std::unordered_map<Entity, Touch> touches;
+		};
+		struct Body {
+			Entity entity;
+			glm::vec3 position;
+			const ColliderShape* collider;
+			CollisionLayer layer;
+			CollisionLayer mask;
+		};
+
+		void collideBody(uint32_t plane, const Body& body);
+	private:
+		std::vector<Slot> m_planes{};
+		std::vector<uint32_t> m_freePlanes{};
+		size_t m_planeCount = 0;
+
+		size_t m_count = 0;
+		uint32_t m_step = 0;
+		std::vector<Body> m_bodies{};
+		// World boxes of the bodies as center and half extent, padded to the SIMD width.
+		std::vector<float> m_centerX{};
+		std::vector<float> m_centerY{};
+		std::vector<float> m_centerZ{};
+		std::vector<float> m_extentX{};
+		std::vector<float> m_extentY{};
+		std::vector<float> m_extentZ{};
+		// 1 for bodies whose box reaches the plane being tested.
+		std::vector<float> m_touching{};
+		// The last step each entity was set in.
+		std::vector<uint32_t> m_bodyStep;
+
+		std::vector<PlaneContact> m_contacts{};
+		std::vector<PlaneContact> m_previous{};
+		std::vector<PlaneContact> m_ended{};
+		// Ended by removals since the last collide, reported by the next one.
+		std::vector<PlaneContact> m_endedPending{};
+		// Points of the body being tested, and its contacts with the plane.
+		std::vector<glm::vec3> m_points{};
+		std::vector<ContactPoint> m_found{};
+	};
+}
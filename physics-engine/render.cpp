@@ -9,11 +9,13 @@ void Render::init() {
 	glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
 }
 
-void Render::render() {
+void Render::render(const Physics::InterpolationFrame& bodies, double alpha) {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	renderSkybox(m_system->getView(), m_system->getProjection());
 
+	m_system->setInterpolation(&bodies);
+	m_system->setPhysicsAlpha(static_cast<float>(alpha));
 	m_system->update(*m_dt);
 
 }
@@ -16,7 +16,9 @@ public:
 	~Render() = default;
 public:
 	void init();
-	void render();
+	/* Draws the bodies alpha of the way between their last two physics steps. */
+	void render(const Physics::InterpolationFrame& bodies, double alpha);
+	glm::vec3 getCameraPosition() { return m_system->getCameraPosition(); }
 private:
 	void renderSkybox(glm::mat3 view, glm::mat4 projection);
 private:
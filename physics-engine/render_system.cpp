@@ -118,41 +118,58 @@ void RenderSystem::update(float deltaTime) {
 
 	m_plane.draw();
 
-	for (Entity entity : m_entities) {
-		auto const& appearance = m_coordinator.getComponent<Components::Appearence>(entity);
-		auto const& transform = m_coordinator.getComponent<Components::Transform>(entity);
-		auto const& shape = m_coordinator.getComponent<Components::RenderShape>(entity);
-		auto const& body = m_coordinator.getComponent<Components::RigidBody>(entity);
+	// The transforms belong to the physics thread, bodies are drawn from its frame
+	if (m_interpolation) {
+		const std::vector<Entity>& entities = m_interpolation->Entities;
+		for (size_t i = 0; i < entities.size(); i++) {
+			// Physics also has bodies that are not drawn, or were destroyed since the frame
+			if (!m_entities.contains(entities[i])) {
+				continue;
+			}
+			const Physics::InterpolatedBody& body = m_interpolation->Bodies[i];
+			drawBody(entities[i], glm::mix(body.Previous, body.Current, m_physicsAlpha), body.Overlapping, body.BoxScale, shader);
+		}
+	} else {
+		for (Entity entity : m_entities) {
+			auto const& body = m_coordinator.getComponent<Components::RigidBody>(entity);
+			drawBody(entity, m_coordinator.getComponent<Components::Transform>(entity).Position, body.Box.overlapping, body.Mass, shader);
+		}
+	}
+}
 
-		glm::mat4 model = glm::mat4(1.0f);
-		model = glm::translate(model, transform.Position);
-		// model = glm::scale(model, transform.Scale);
-		// model = glm::rotate(model, transform.RotationAngle, transform.Rotation);
+// Only reads the components that physics leaves alone.
+void RenderSystem::drawBody(Entity entity, glm::vec3 position, bool overlapping, float boxScale, Shader& shader) {
+	auto const& appearance = m_coordinator.getComponent<Components::Appearence>(entity);
+	auto const& shape = m_coordinator.getComponent<Components::RenderShape>(entity);
 
+	glm::mat4 model = glm::mat4(1.0f);
+	model = glm::translate(model, position);
+	// model = glm::scale(model, transform.Scale);
+	// model = glm::rotate(model, transform.RotationAngle, transform.Rotation);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, appearance.Texture);
+	
+	shader.use();
+	shader.set_mat4("model", model);
+	shader.set_vec3("baseColor", appearance.BaseColor);
+	shader.set_float("opacity", appearance.Opacity);
+
+	shape.Shape->draw();
+	
+	// draw bounding boxes
+	const glm::vec3 bbColor = overlapping ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(1.0f);
+	shader.set_vec3("baseColor", bbColor);
+	model = glm::scale(model, glm::vec3{ boxScale });
+	shader.set_mat4("model", model);
+	if (m_render_bounding_boxes && shape.BoxShape) {
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, appearance.Texture);
-		
-		shader.use();
-		shader.set_mat4("model", model);
-		shader.set_vec3("baseColor", appearance.BaseColor);
-		shader.set_float("opacity", appearance.Opacity);
-
-		shape.Shape->draw();
-		
-		// draw bounding boxes
-		const glm::vec3 bbColor = body.Box.overlapping ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(1.0f);
-		shader.set_vec3("baseColor", bbColor);
-		model = glm::scale(model, glm::vec3{ body.Mass });
-		shader.set_mat4("model", model);
-		if (m_render_bounding_boxes && shape.BoxShape) {
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, m_resourceManager.getTexture("white"));
-			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-			glLineWidth(2);
-			shape.BoxShape->draw();
-			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-			glLineWidth(1);
-		}
+		glBindTexture(GL_TEXTURE_2D, m_resourceManager.getTexture("white"));
+		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		glLineWidth(2);
+		shape.BoxShape->draw();
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		glLineWidth(1);
 	}
 }
 
@@ -174,3 +191,7 @@ glm::mat4 RenderSystem::getProjection() {
 	auto& camera = m_coordinator.getComponent<Components::Camera>(m_camera);
 	return camera.Projection;
 }
+
+glm::vec3 RenderSystem::getCameraPosition() {
+	return m_coordinator.getComponent<Components::Transform>(m_camera).Position;
+}
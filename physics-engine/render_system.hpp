@@ -5,6 +5,7 @@
 #include <memory>
 #include "skybox.hpp"
 #include "finite_plane.hpp"
+#include "interpolation.hpp"
 
 namespace Systems {
 
@@ -17,22 +18,32 @@ namespace Systems {
 			Resources::ResourceManager& rm
 		) : System(c),
 			m_plane(),
+			m_render_bounding_boxes(false),
+			m_camera(),
 			m_keyboardManager(km),
 			m_mouseManager(mm),
-			m_resourceManager(rm),
-			m_camera(),
-			m_render_bounding_boxes(false) { }
+			m_resourceManager(rm) { }
 	public:
 		void init();
 		void update(float deltaTime) override;
 		void toggleBoxRendering();
 
+		/* Bodies are drawn alpha of the way between their last two physics steps, bodies not in the
+		   frame yet are not drawn. Without a frame bodies are drawn where their transform is. */
+		void setInterpolation(const Physics::InterpolationFrame* interpolation) { m_interpolation = interpolation; }
+		void setPhysicsAlpha(float alpha) { m_physicsAlpha = alpha; }
+
 		glm::mat4 getView();
 		glm::mat4 getProjection();
+		glm::vec3 getCameraPosition();
+	private:
+		void drawBody(Entity entity, glm::vec3 position, bool overlapping, float boxScale, Shader& shader);
 	private:
 		FinitePlane m_plane;
 		bool m_render_bounding_boxes; 
 		Entity m_camera;
+		const Physics::InterpolationFrame* m_interpolation = nullptr;
+		float m_physicsAlpha = 1.0f;
 
 		Input::KeyboardManager& m_keyboardManager;
 		Input::MouseManager& m_mouseManager;
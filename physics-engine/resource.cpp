@@ -111,33 +111,7 @@ void GeometryResources::init() {
 	}
 	add("sphere", *sphereGen.build());
 
-	// create terrain mesh using some perlin noise
-	Geometry::ProceduralBuilder terrain;
-	uint32_t seed = (uint32_t)time(NULL);
-	const siv::PerlinNoise perlin{ seed };
-	int width = 256, height = 256;
-	int depth = 100;
-	uint32_t oct0 = 4;
-	const double fx = (1.0f / width);
-	const double fy = (1.0f / height);
-	for (int x = -width; x < width; x++) {
-		for (int y = -height; y < height; y++) {
-			double d0 = perlin.octave2D_01(fx * x, fy * y, oct0);
-			double d1 = perlin.octave2D_01(fx * x, fy * (y + 1), oct0);
-			double d2 = perlin.octave2D_01(fx * (x + 1), fy * y, oct0);
-			double d3 = perlin.octave2D_01(fx * (x + 1), fy * (y + 1), oct0);
-			glm::vec2 texture = glm::vec2(x / width, y / height);
-			glm::vec3 normal = glm::vec3(0.0f, 1.0f, 0.0f);
-			Geometry::vertex v0 = { .position = glm::vec3((float)x, (float)d0 * (float)depth, (float)y), .normal = normal, .texture = texture};
-			Geometry::vertex v1 = { .position = glm::vec3((float)x, (float)d1 * (float)depth, (float)y + 1.0f), .normal = normal, .texture = texture };
-			Geometry::vertex v2 = { .position = glm::vec3((float)x + 1.0f, (float)d2 * (float)depth, (float)y), .normal = normal, .texture = texture };
-			Geometry::vertex v3 = { .position = glm::vec3((float)x + 1.0f, (float)d3 * (float)depth, (float)y + 1.0f), .normal = normal, .texture = texture };
-
-			terrain.addQuad({ v0, v2, v3, v1 });
-		}
-	}
-
-	add("terrain", *terrain.build());
+	// The terrain mesh is built from its heightfield by ResourceManager::init.
 
 	// generate skybox mesh
 	static const float skyboxVertices[] = { -1.0f,  1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f,  1.0f, -1.0f, -1.0f,  1.0f, -1.0f,  -1.0f, -1.0f,  1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f,  1.0f, -1.0f, -1.0f,  1.0f,  1.0f, -1.0f, -1.0f, 1.0f, -1.0f,  1.0f, 1.0f,  1.0f,  1.0f, 1.0f,  1.0f,  1.0f, 1.0f,  1.0f, -1.0f, 1.0f, -1.0f, -1.0f,  -1.0f, -1.0f,  1.0f, -1.0f,  1.0f,  1.0f, 1.0f,  1.0f,  1.0f, 1.0f,  1.0f,  1.0f, 1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f,  -1.0f,  1.0f, -1.0f, 1.0f,  1.0f, -1.0f, 1.0f,  1.0f,  1.0f, 1.0f,  1.0f,  1.0f, -1.0f,  1.0f,  1.0f, -1.0f,  1.0f, -1.0f,  -1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  1.0f, 1.0f, -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  1.0f, 1.0f, -1.0f,  1.0f };
@@ -149,6 +123,45 @@ void GeometryResources::init() {
 	add("skybox", skybox);
 }
 
+void HullResources::init() {
+	// Nothing to load, hulls are built from geometry when first requested.
+}
+
+void LevelResources::init() {
+	// Nothing to load, levels are compiled or read from their cache file when first requested.
+}
+
+void HeightFieldResources::init() {
+	std::cout << "[Registry] Generating heightfields..." << std::endl;
+	// terrain using some perlin noise, 512 x 512 cells
+	uint32_t seed = (uint32_t)time(NULL);
+	const siv::PerlinNoise perlin{ seed };
+	int width = 256, height = 256;
+	int depth = 100;
+	uint32_t oct0 = 4;
+	const double fx = (1.0f / width);
+	const double fy = (1.0f / height);
+	add("terrain", Physics::buildHeightField(2 * width + 1, 2 * height + 1, 1.0f, [&](float x, float z) {
+		return (float)perlin.octave2D_01(fx * (x - width), fy * (z - height), oct0) * (float)depth;
+	}));
+}
+
+// The mesh of a heightfield, in the same local space as its collider: the triangles of cell
+// (i, j) are those HeightFieldData::triangle gives.
+static Geometry::Geometry3D heightFieldGeometry(const Physics::HeightFieldData& data) {
+	Geometry::ProceduralBuilder builder;
+	auto vertex = [&data](uint32_t i, uint32_t j) {
+		return Geometry::vertex{ .position = data.vertex(i, j), .normal = glm::vec3(0.0f, 1.0f, 0.0f),
+			.texture = glm::vec2((float)i / (data.Columns - 1), (float)j / (data.Rows - 1)) };
+	};
+	for (uint32_t j = 0; j + 1 < data.Rows; j++) {
+		for (uint32_t i = 0; i + 1 < data.Columns; i++) {
+			builder.addQuad({ vertex(i, j), vertex(i + 1, j), vertex(i + 1, j + 1), vertex(i, j + 1) });
+		}
+	}
+	return *builder.build();
+}
+
 void ShaderResources::init() {
 	std::cout << "[Registry] Generating shaders..." << std::endl;
 	Shader VS_transform = Shader("shaders/VS_transform.glsl", "shaders/FS_transform.glsl");
@@ -197,7 +210,12 @@ TextureResources:: ~TextureResources() {
 void ResourceManager::init() {
 	Textures->init();
 	Geometries->init();
+	Hulls->init();
+	HeightFields->init();
+	Levels->init();
 	Shaders->init();
+	// terrain bodies draw the heightfield they collide with
+	Geometries->add("terrain", heightFieldGeometry(*getHeightField("terrain")));
 }
 
 texture_t& ResourceManager::getTexture(std::string name) {
@@ -210,4 +228,26 @@ Geometry::Geometry3D& ResourceManager::getGeometry(std::string name) {
 
 Shader& ResourceManager::getShader(std::string name) {
 	return Shaders->get(name);
+}
+
+std::shared_ptr<const Physics::HullMesh> ResourceManager::getHull(std::string name, size_t maxVertices) {
+	auto& hulls = Hulls->get_all();
+	auto it = hulls.find(name);
+	if (it == hulls.end()) {
+		it = hulls.emplace(name, std::make_shared<Physics::HullMesh>(Physics::buildHull(getGeometry(name), maxVertices))).first;
+	}
+	return it->second;
+}
+
+std::shared_ptr<const Physics::HeightFieldData> ResourceManager::getHeightField(std::string name) {
+	return HeightFields->get_all().at(name);
+}
+
+std::shared_ptr<const Physics::BSPTree> ResourceManager::getLevel(std::string name) {
+	auto& levels = Levels->get_all();
+	auto it = levels.find(name);
+	if (it == levels.end()) {
+		it = levels.emplace(name, std::make_shared<Physics::BSPTree>(Physics::loadOrCompileBSP(getGeometry(name), "levels/" + name + ".bsp"))).first;
+	}
+	return it->second;
 }
\ No newline at end of file
@@ -6,6 +6,9 @@
 #include "geometry.hpp"
 #include "types.hpp"
 #include "shader.hpp"
+#include "hull.hpp"
+#include "heightfield.hpp"
+#include "bsp.hpp"
 
 namespace Resources {
 	template<class T>
@@ -45,6 +48,34 @@ namespace Resources {
 		virtual void init();
 	};
 
+	// Collision hulls, built on demand from geometries of the same name by ResourceManager::getHull.
+	class HullResources : public Resource<Physics::HullMesh> {
+	public:
+		HullResources() = default;
+		~HullResources() = default;
+	public:
+		virtual void init();
+	};
+
+	// Height grids of terrains, shared by their meshes and colliders.
+	class HeightFieldResources : public Resource<Physics::HeightFieldData> {
+	public:
+		HeightFieldResources() = default;
+		~HeightFieldResources() = default;
+	public:
+		virtual void init();
+	};
+
+	// Compiled BSP trees of static levels, built on demand from geometries of the same name by
+	// ResourceManager::getLevel.
+	class LevelResources : public Resource<Physics::BSPTree> {
+	public:
+		LevelResources() = default;
+		~LevelResources() = default;
+	public:
+		virtual void init();
+	};
+
 	class ShaderResources : public Resource<Shader> {
 	public:
 		ShaderResources() = default;
@@ -73,6 +104,9 @@ namespace Resources {
 		ResourceManager()
 			: Textures(std::make_unique<TextureResources>()),
 			Geometries(std::make_unique<GeometryResources>()),
+			Hulls(std::make_unique<HullResources>()),
+			HeightFields(std::make_unique<HeightFieldResources>()),
+			Levels(std::make_unique<LevelResources>()),
 			Shaders(std::make_unique<ShaderResources>()) {}
 	public:
 		void init();
@@ -80,10 +114,21 @@ namespace Resources {
 		texture_t& getTexture(std::string name);
 		Geometry::Geometry3D& getGeometry(std::string name);
 		Shader& getShader(std::string name);
+		// The convex hull of a geometry, simplified to at most maxVertices. Built on first use and
+		// cached by name, later calls return the cached hull whatever their budget.
+		std::shared_ptr<const Physics::HullMesh> getHull(std::string name, size_t maxVertices = Physics::HULL_DEFAULT_MAX_VERTICES);
+		// For the collider of a terrain body, Physics::HeightField{ getHeightField(name) }.
+		std::shared_ptr<const Physics::HeightFieldData> getHeightField(std::string name);
+		// The BSP tree of a level geometry, for the collider of a level body. Loaded from
+		// levels/<name>.bsp, or compiled and written there if the file is missing or stale.
+		std::shared_ptr<const Physics::BSPTree> getLevel(std::string name);
 		~ResourceManager() = default;
 	private:
 		std::unique_ptr<TextureResources> Textures;
 		std::unique_ptr<GeometryResources> Geometries;
+		std::unique_ptr<HullResources> Hulls;
+		std::unique_ptr<HeightFieldResources> HeightFields;
+		std::unique_ptr<LevelResources> Levels;
 		std::unique_ptr<ShaderResources> Shaders;
 	};
 };
\ No newline at end of file
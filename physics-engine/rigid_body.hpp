@@ -1,6 +1,8 @@
 #pragma once
 #include <glm/glm.hpp>
 #include "box.hpp"
+#include "collision_filter.hpp"
+#include "collider.hpp"
 
 namespace Components {
 	struct RigidBody {
@@ -13,8 +15,30 @@ namespace Components {
 
 		float Mass;
 		float Restitution;
+		// Coulomb friction coefficient. Two bodies in contact use the geometric mean of theirs.
+		float Friction = 0.5f;
+		// Always swept for continuous collision, not only when moving fast. See Physics::CCD_MOTION_FRACTION.
+		bool Bullet = false;
+		// A trigger volume. Bodies overlapping it only report TriggerEnter and TriggerExit events, see
+		// Physics::ContactEvent; nothing pushes it or is pushed by it, and it passes through planes.
+		bool Sensor = false;
 
 		glm::vec3 Velocity;
 		glm::vec3 Force;
+
+		// Layers this body belongs to, and layers it collides with. Checked by the broad phase.
+		Physics::CollisionLayer Layer = Physics::Layers::Default;
+		Physics::CollisionLayer Mask = Physics::Layers::All;
+
+		// Convex shape used by the narrow phase. Left empty, the body collides as its Box. Terrain and
+		// level bodies use a HeightField or Level instead, they must be anchored and get their Box
+		// from it.
+		Physics::ColliderShape Collider{};
+
+		// Set by the physics system. A sleeping body is neither moved nor collision tested until
+		// something touches it or it is woken, see PhysicsSystem::wake.
+		bool Sleeping = false;
+		// Steps in a row the body has been resting, see Physics::SleepSettings.
+		uint32_t RestingSteps = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,293 @@
+#include "scene_query.hpp"
+#include "simd.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+using namespace Physics;
+
+namespace {
+	// A ray packet in SoA form. Casts are rays against boxes grown by the cast shape:
+	// a box [min, max] is tested as [min - lo, max + hi].
+	struct Packet {
+		alignas(16) float ox[RAY_PACKET_SIZE];
+		alignas(16) float oy[RAY_PACKET_SIZE];
+		alignas(16) float oz[RAY_PACKET_SIZE];
+		alignas(16) float ix[RAY_PACKET_SIZE];
+		alignas(16) float iy[RAY_PACKET_SIZE];
+		alignas(16) float iz[RAY_PACKET_SIZE];
+		alignas(16) float lox[RAY_PACKET_SIZE];
+		alignas(16) float loy[RAY_PACKET_SIZE];
+		alignas(16) float loz[RAY_PACKET_SIZE];
+		alignas(16) float hix[RAY_PACKET_SIZE];
+		alignas(16) float hiy[RAY_PACKET_SIZE];
+		alignas(16) float hiz[RAY_PACKET_SIZE];
+		// Nearest hit so far (or the max distance). Negative for unused lanes.
+		alignas(16) float tmax[RAY_PACKET_SIZE];
+		glm::vec3 direction[RAY_PACKET_SIZE];
+		CollisionLayer mask[RAY_PACKET_SIZE];
+		Entity ignore[RAY_PACKET_SIZE];
+		CollisionLayer anyMask;
+	};
+
+	// Keeps 1 / d finite so that slab tests never produce 0 * inf.
+	float safeInverse(float d) {
+		return 1.0f / (std::fabs(d) < 1e-20f ? std::copysign(1e-20f, d) : d);
+	}
+
+	void setLane(Packet& p, size_t lane, glm::vec3 origin, glm::vec3 direction, float maxDistance,
+		glm::vec3 lo, glm::vec3 hi, CollisionLayer mask, Entity ignore) {
+		const float length = glm::length(direction);
+		const glm::vec3 d = length > 0.0f ? direction / length : glm::vec3(0.0f);
+		p.ox[lane] = origin.x;
+		p.oy[lane] = origin.y;
+		p.oz[lane] = origin.z;
+		p.ix[lane] = safeInverse(d.x);
+		p.iy[lane] = safeInverse(d.y);
+		p.iz[lane] = safeInverse(d.z);
+		p.lox[lane] = lo.x;
+		p.loy[lane] = lo.y;
+		p.loz[lane] = lo.z;
+		p.hix[lane] = hi.x;
+		p.hiy[lane] = hi.y;
+		p.hiz[lane] = hi.z;
+		p.tmax[lane] = length > 0.0f ? maxDistance : -1.0f;
+		p.direction[lane] = d;
+		p.mask[lane] = mask;
+		p.ignore[lane] = ignore;
+		p.anyMask |= mask;
+	}
+
+	void clearLanes(Packet& p, size_t from) {
+		for (size_t lane = from; lane < RAY_PACKET_SIZE; lane++) {
+			setLane(p, lane, glm::vec3(0.0f), glm::vec3(0.0f), -1.0f, glm::vec3(0.0f), glm::vec3(0.0f), Layers::None, MAX_ENTITIES);
+		}
+	}
+
+	// Slab test of the whole packet against one box. Returns a bit per lane that hits the box
+	// closer than its current nearest hit.
+	uint32_t packetOverlaps(const Packet& p, const BoundingBox& box) {
+#if defined(PHYSICS_SIMD_SSE2)
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 ox = _mm_load_ps(p.ox);
+		const __m128 oy = _mm_load_ps(p.oy);
+		const __m128 oz = _mm_load_ps(p.oz);
+
+		const __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_set1_ps(box.min.x), _mm_load_ps(p.lox)), ox), _mm_load_ps(p.ix));
+		const __m128 x2 = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_set1_ps(box.max.x), _mm_load_ps(p.hix)), ox), _mm_load_ps(p.ix));
+		const __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_set1_ps(box.min.y), _mm_load_ps(p.loy)), oy), _mm_load_ps(p.iy));
+		const __m128 y2 = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_set1_ps(box.max.y), _mm_load_ps(p.hiy)), oy), _mm_load_ps(p.iy));
+		const __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_set1_ps(box.min.z), _mm_load_ps(p.loz)), oz), _mm_load_ps(p.iz));
+		const __m128 z2 = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_set1_ps(box.max.z), _mm_load_ps(p.hiz)), oz), _mm_load_ps(p.iz));
+
+		__m128 tEnter = _mm_max_ps(_mm_max_ps(_mm_min_ps(x1, x2), _mm_min_ps(y1, y2)), _mm_max_ps(_mm_min_ps(z1, z2), zero));
+		__m128 tExit = _mm_min_ps(_mm_min_ps(_mm_max_ps(x1, x2), _mm_max_ps(y1, y2)), _mm_min_ps(_mm_max_ps(z1, z2), _mm_load_ps(p.tmax)));
+		return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(tEnter, tExit)));
+#else
+		uint32_t lanes = 0;
+		for (size_t lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+			const float x1 = (box.min.x - p.lox[lane] - p.ox[lane]) * p.ix[lane];
+			const float x2 = (box.max.x + p.hix[lane] - p.ox[lane]) * p.ix[lane];
+			const float y1 = (box.min.y - p.loy[lane] - p.oy[lane]) * p.iy[lane];
+			const float y2 = (box.max.y + p.hiy[lane] - p.oy[lane]) * p.iy[lane];
+			const float z1 = (box.min.z - p.loz[lane] - p.oz[lane]) * p.iz[lane];
+			const float z2 = (box.max.z + p.hiz[lane] - p.oz[lane]) * p.iz[lane];
+			const float tEnter = std::max(std::max(std::min(x1, x2), std::min(y1, y2)), std::max(std::min(z1, z2), 0.0f));
+			const float tExit = std::min(std::min(std::max(x1, x2), std::max(y1, y2)), std::min(std::max(z1, z2), p.tmax[lane]));
+			lanes |= (tEnter <= tExit ? 1u : 0u) << lane;
+		}
+		return lanes;
+#endif
+	}
+
+	// Exact test of one lane against a leaf's world box, also finds the hit normal.
+	bool laneHit(const Packet& p, size_t lane, const BoundingBox& box, float& t, glm::vec3& normal) {
+		const glm::vec3 origin = glm::vec3(p.ox[lane], p.oy[lane], p.oz[lane]);
+		const glm::vec3 inverse = glm::vec3(p.ix[lane], p.iy[lane], p.iz[lane]);
+		const glm::vec3 min = box.min - glm::vec3(p.lox[lane], p.loy[lane], p.loz[lane]);
+		const glm::vec3 max = box.max + glm::vec3(p.hix[lane], p.hiy[lane], p.hiz[lane]);
+
+		float tEnter = -FLT_MAX;
+		float tExit = FLT_MAX;
+		int axis = 0;
+		for (int a = 0; a < 3; a++) {
+			float t1 = (min[a] - origin[a]) * inverse[a];
+			float t2 = (max[a] - origin[a]) * inverse[a];
+			if (t1 > t2) {
+				std::swap(t1, t2);
+			}
+			if (t1 > tEnter) {
+				tEnter = t1;
+				axis = a;
+			}
+			tExit = std::min(tExit, t2);
+		}
+		if (tEnter > tExit || tExit < 0.0f) {
+			return false;
+		}
+
+		const glm::vec3& d = p.direction[lane];
+		if (tEnter < 0.0f) {
+			// Started inside the box.
+			t = 0.0f;
+			normal = -d;
+		} else {
+			t = tEnter;
+			normal = glm::vec3(0.0f);
+			normal[axis] = d[axis] > 0.0f ? -1.0f : 1.0f;
+		}
+		return true;
+	}
+
+	void traverse(const AABBTree& tree, Packet& p, std::span<RayHit> hits, const ExactRaycast* exact) {
+		if (tree.getRoot() == NULL_NODE) {
+			return;
+		}
+		NodeIndex stack[TREE_STACK_SIZE];
+		size_t top = 0;
+		stack[top++] = tree.getRoot();
+		while (top > 0) {
+			const NodeIndex index = stack[--top];
+			const TreeNode& node = tree.getNode(index);
+			if ((node.layers & p.anyMask) == 0) {
+				continue;
+			}
+			uint32_t lanes = packetOverlaps(p, node.box);
+			if (lanes == 0) {
+				continue;
+			}
+
+			if (node.isLeaf()) {
+				const BoundingBox& box = tree.getWorldBox(index);
+				for (; lanes != 0; lanes &= lanes - 1) {
+					const size_t lane = static_cast<size_t>(std::countr_zero(lanes));
+					if (lane >= hits.size() || (node.layers & p.mask[lane]) == 0 || node.entity == p.ignore[lane]) {
+						continue;
+					}
+					const glm::vec3 origin = glm::vec3(p.ox[lane], p.oy[lane], p.oz[lane]);
+					float t;
+					glm::vec3 normal;
+					const bool hit = exact != nullptr && exact->covers(node.entity)
+						? exact->raycast(node.entity, origin, p.direction[lane], p.tmax[lane], t, normal)
+						: laneHit(p, lane, box, t, normal);
+					if (hit && t < p.tmax[lane]) {
+						p.tmax[lane] = t;
+						hits[lane] = RayHit{ true, node.entity, t, origin + p.direction[lane] * t, normal };
+					}
+				}
+				continue;
+			}
+
+			// Visit the child nearer to the lead ray first, it is more likely to shrink tmax.
+			const size_t lead = static_cast<size_t>(std::countr_zero(lanes));
+			const glm::vec3 origin = glm::vec3(p.ox[lead], p.oy[lead], p.oz[lead]);
+			const BoundingBox& left = tree.getNode(node.left).box;
+			const BoundingBox& right = tree.getNode(node.right).box;
+			const float dl = glm::dot((left.min + left.max) * 0.5f - origin, p.direction[lead]);
+			const float dr = glm::dot((right.min + right.max) * 0.5f - origin, p.direction[lead]);
+			if (dl < dr) {
+				stack[top++] = node.right;
+				stack[top++] = node.left;
+			} else {
+				stack[top++] = node.left;
+				stack[top++] = node.right;
+			}
+		}
+	}
+}
+
+void Physics::raycastPacket(std::span<const AABBTree* const> trees, std::span<const Ray> rays, std::span<RayHit> hits, const ExactRaycast* exact) {
+	Packet p{};
+	const size_t count = std::min({ rays.size(), hits.size(), RAY_PACKET_SIZE });
+	for (size_t lane = 0; lane < count; lane++) {
+		const Ray& ray = rays[lane];
+		setLane(p, lane, ray.Origin, ray.Direction, ray.MaxDistance, glm::vec3(0.0f), glm::vec3(0.0f), ray.Mask, ray.Ignore);
+		hits[lane] = RayHit{};
+	}
+	clearLanes(p, count);
+
+	for (const AABBTree* tree : trees) {
+		traverse(*tree, p, hits.first(count), exact);
+	}
+}
+
+void Physics::shapecastPacket(std::span<const AABBTree* const> trees, std::span<const ShapeCast> casts, std::span<RayHit> hits) {
+	Packet p{};
+	const size_t count = std::min({ casts.size(), hits.size(), RAY_PACKET_SIZE });
+	for (size_t lane = 0; lane < count; lane++) {
+		const ShapeCast& cast = casts[lane];
+		// Minkowski sum of the world box and the cast box: [min - castMax, max - castMin].
+		setLane(p, lane, cast.Origin, cast.Direction, cast.MaxDistance, cast.Box.max, -cast.Box.min, cast.Mask, cast.Ignore);
+		hits[lane] = RayHit{};
+	}
+	clearLanes(p, count);
+
+	for (const AABBTree* tree : trees) {
+		traverse(*tree, p, hits.first(count), nullptr);
+	}
+}
+
+namespace {
+	// Collects the leaves whose fat box overlaps bounds and whose world box passes the exact test.
+	// Fat boxes are conservative, so the exact test is what decides.
+	template<class Exact>
+	size_t overlap(std::span<const AABBTree* const> trees, const BoundingBox& bounds, CollisionLayer mask, Entity ignore,
+		std::span<Entity> results, Exact&& exact) {
+		size_t count = 0;
+		for (const AABBTree* tree : trees) {
+			if (count == results.size()) {
+				break;
+			}
+			tree->query(bounds, [&](NodeIndex proxy) {
+				const Entity entity = tree->getEntity(proxy);
+				if (entity != ignore && exact(tree->getWorldBox(proxy))) {
+					results[count++] = entity;
+				}
+				return count < results.size();
+			}, Layers::All, mask);
+		}
+		return count;
+	}
+
+	template<class Query, class Single>
+	size_t overlapBatch(std::span<const Query> queries, std::span<Entity> results, std::span<OverlapRange> ranges, Single&& single) {
+		size_t offset = 0;
+		const size_t count = std::min(queries.size(), ranges.size());
+		for (size_t i = 0; i < count; i++) {
+			const size_t found = single(queries[i], results.subspan(offset));
+			ranges[i] = OverlapRange{ offset, found };
+			offset += found;
+		}
+		return offset;
+	}
+}
+
+size_t Physics::overlapAABB(std::span<const AABBTree* const> trees, const BoxOverlap& query, std::span<Entity> results) {
+	return overlap(trees, query.Box, query.Mask, query.Ignore, results, [&](const BoundingBox& box) {
+		return box.overlaps(query.Box);
+	});
+}
+
+size_t Physics::overlapSphere(std::span<const AABBTree* const> trees, const SphereOverlap& query, std::span<Entity> results) {
+	BoundingBox bounds{};
+	bounds.min = query.Center - query.Radius;
+	bounds.max = query.Center + query.Radius;
+	const float radiusSquared = query.Radius * query.Radius;
+	return overlap(trees, bounds, query.Mask, query.Ignore, results, [&](const BoundingBox& box) {
+		const glm::vec3 closest = glm::clamp(query.Center, box.min, box.max);
+		const glm::vec3 d = closest - query.Center;
+		return glm::dot(d, d) <= radiusSquared;
+	});
+}
+
+size_t Physics::overlapAABBBatch(std::span<const AABBTree* const> trees, std::span<const BoxOverlap> queries, std::span<Entity> results, std::span<OverlapRange> ranges) {
+	return overlapBatch(queries, results, ranges, [&](const BoxOverlap& query, std::span<Entity> out) {
+		return overlapAABB(trees, query, out);
+	});
+}
+
+size_t Physics::overlapSphereBatch(std::span<const AABBTree* const> trees, std::span<const SphereOverlap> queries, std::span<Entity> results, std::span<OverlapRange> ranges) {
+	return overlapBatch(queries, results, ranges, [&](const SphereOverlap& query, std::span<Entity> out) {
+		return overlapSphere(trees, query, out);
+	});
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <span>
+#include <cfloat>
+#include <glm/glm.hpp>
+#include "aabb_tree.hpp"
+
+namespace Physics {
+
+	// A ray for scene queries. The direction does not have to be normalized, distances are
+	// reported in world units along the normalized direction.
+	struct Ray {
+		glm::vec3 Origin;
+		glm::vec3 Direction;
+		float MaxDistance = FLT_MAX;
+		// Only bodies on these layers are hit.
+		CollisionLayer Mask = Layers::All;
+		// A body to ignore, e.g. the one casting the ray. MAX_ENTITIES ignores nothing.
+		Entity Ignore = MAX_ENTITIES;
+	};
+
+	// Sweeps a box, given in local coordinates around Origin, along Direction.
+	struct ShapeCast {
+		BoundingBox Box;
+		glm::vec3 Origin;
+		glm::vec3 Direction;
+		float MaxDistance = FLT_MAX;
+		CollisionLayer Mask = Layers::All;
+		Entity Ignore = MAX_ENTITIES;
+	};
+
+	// The nearest hit of a ray or shape cast. For a shape cast Point is where the swept shape's
+	// origin is at the time of impact.
+	struct RayHit {
+		bool Hit = false;
+		Entity Body = MAX_ENTITIES;
+		float Distance = FLT_MAX;
+		glm::vec3 Point = glm::vec3(0.0f);
+		glm::vec3 Normal = glm::vec3(0.0f);
+	};
+
+	// Region queries. They report every body whose world box overlaps the region.
+	struct BoxOverlap {
+		BoundingBox Box;
+		CollisionLayer Mask = Layers::All;
+		Entity Ignore = MAX_ENTITIES;
+	};
+
+	struct SphereOverlap {
+		glm::vec3 Center;
+		float Radius;
+		CollisionLayer Mask = Layers::All;
+		Entity Ignore = MAX_ENTITIES;
+	};
+
+	// Where the results of one query of a batch were written: results[Offset, Offset + Count).
+	struct OverlapRange {
+		size_t Offset = 0;
+		size_t Count = 0;
+	};
+
+	// Number of rays traversed together as one packet.
+	constexpr size_t RAY_PACKET_SIZE = 4;
+
+	// Bodies whose world box is a poor stand-in for their shape, like terrain. Rays reaching the
+	// box of a covered body hit what raycast finds instead of the box.
+	class ExactRaycast {
+	public:
+		virtual ~ExactRaycast() = default;
+		virtual bool covers(Entity entity) const = 0;
+		// Nearest hit within maxDistance, direction is normalized.
+		virtual bool raycast(Entity entity, glm::vec3 origin, glm::vec3 direction, float maxDistance, float& t, glm::vec3& normal) const = 0;
+	};
+
+	// Finds the nearest hit for up to RAY_PACKET_SIZE rays or casts against the trees.
+	// Rays in a packet share one traversal, nodes are tested against all of them at once.
+	// Shape casts only ever hit world boxes.
+	void raycastPacket(std::span<const AABBTree* const> trees, std::span<const Ray> rays, std::span<RayHit> hits, const ExactRaycast* exact = nullptr);
+	void shapecastPacket(std::span<const AABBTree* const> trees, std::span<const ShapeCast> casts, std::span<RayHit> hits);
+
+	// Write the overlapping bodies into results and return how many were written. Nothing is
+	// allocated; the query stops once results is full.
+	size_t overlapAABB(std::span<const AABBTree* const> trees, const BoxOverlap& query, std::span<Entity> results);
+	size_t overlapSphere(std::span<const AABBTree* const> trees, const SphereOverlap& query, std::span<Entity> results);
+
+	// Run the queries one after another, packing their results into one buffer. ranges[i] tells
+	// where the results of queries[i] are. Returns the total number of results written.
+	size_t overlapAABBBatch(std::span<const AABBTree* const> trees, std::span<const BoxOverlap> queries, std::span<Entity> results, std::span<OverlapRange> ranges);
+	size_t overlapSphereBatch(std::span<const AABBTree* const> trees, std::span<const SphereOverlap> queries, std::span<Entity> results, std::span<OverlapRange> ranges);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+/*
+* 
+* SIMD instruction set selection. Determined at compile-time from the compiler's target flags
+* (e.g. /arch:AVX2 on MSVC, -mavx2 elsewhere). Define PHYSICS_NO_SIMD to force the scalar paths.
+* 
+*/
+#if !defined(PHYSICS_NO_SIMD)
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define PHYSICS_SIMD_SSE2 1
+		#include <emmintrin.h>
+	#endif
+	#if defined(__AVX2__)
+		#define PHYSICS_SIMD_AVX2 1
+		#include <immintrin.h>
+	#endif
+#endif
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace Physics::Simd {
+
+	/*
+	*
+	* Lane types for kernels written once as templates. Float8 (AVX2) and Float4 (SSE2) wrap a
+	* register, plain float is the scalar fallback and the tail loop. Comparisons return masks,
+	* combined with & and | and consumed by select().
+	*
+	*/
+	inline float select(bool mask, float a, float b) { return mask ? a : b; }
+	inline float maskToFloat(bool mask) { return mask ? 1.0f : 0.0f; }
+	inline float min(float a, float b) { return std::min(a, b); }
+	inline float max(float a, float b) { return std::max(a, b); }
+	inline float sqrt(float a) { return std::sqrt(a); }
+	inline float abs(float a) { return std::fabs(a); }
+	inline bool any(bool mask) { return mask; }
+
+	template<class V> V load(const float* p);
+	template<class V> V splat(float x);
+	template<> inline float load<float>(const float* p) { return *p; }
+	template<> inline float splat<float>(float x) { return x; }
+	inline void store(float* p, float v) { *p = v; }
+
+	template<class V> constexpr size_t width = 1;
+
+#if defined(PHYSICS_SIMD_SSE2)
+	struct Float4 {
+		__m128 v;
+	};
+	template<> constexpr size_t width<Float4> = 4;
+
+	inline Float4 operator+(Float4 a, Float4 b) { return { _mm_add_ps(a.v, b.v) }; }
+	inline Float4 operator-(Float4 a, Float4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+	inline Float4 operator*(Float4 a, Float4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+	inline Float4 operator/(Float4 a, Float4 b) { return { _mm_div_ps(a.v, b.v) }; }
+	inline Float4 operator-(Float4 a) { return { _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)) }; }
+	inline Float4 operator<(Float4 a, Float4 b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+	inline Float4 operator<=(Float4 a, Float4 b) { return { _mm_cmple_ps(a.v, b.v) }; }
+	inline Float4 operator>(Float4 a, Float4 b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+	inline Float4 operator>=(Float4 a, Float4 b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+	inline Float4 operator&(Float4 a, Float4 b) { return { _mm_and_ps(a.v, b.v) }; }
+	inline Float4 operator|(Float4 a, Float4 b) { return { _mm_or_ps(a.v, b.v) }; }
+	inline Float4 select(Float4 mask, Float4 a, Float4 b) { return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) }; }
+	inline Float4 maskToFloat(Float4 mask) { return { _mm_and_ps(mask.v, _mm_set1_ps(1.0f)) }; }
+	inline Float4 min(Float4 a, Float4 b) { return { _mm_min_ps(a.v, b.v) }; }
+	inline Float4 max(Float4 a, Float4 b) { return { _mm_max_ps(a.v, b.v) }; }
+	inline Float4 sqrt(Float4 a) { return { _mm_sqrt_ps(a.v) }; }
+	inline Float4 abs(Float4 a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; }
+	inline bool any(Float4 mask) { return _mm_movemask_ps(mask.v) != 0; }
+	template<> inline Float4 load<Float4>(const float* p) { return { _mm_loadu_ps(p) }; }
+	template<> inline Float4 splat<Float4>(float x) { return { _mm_set1_ps(x) }; }
+	inline void store(float* p, Float4 v) { _mm_storeu_ps(p, v.v); }
+#endif
+
+#if defined(PHYSICS_SIMD_AVX2)
+	struct Float8 {
+		__m256 v;
+	};
+	template<> constexpr size_t width<Float8> = 8;
+
+	inline Float8 operator+(Float8 a, Float8 b) { return { _mm256_add_ps(a.v, b.v) }; }
+	inline Float8 operator-(Float8 a, Float8 b) { return { _mm256_sub_ps(a.v, b.v) }; }
+	inline Float8 operator*(Float8 a, Float8 b) { return { _mm256_mul_ps(a.v, b.v) }; }
+	inline Float8 operator/(Float8 a, Float8 b) { return { _mm256_div_ps(a.v, b.v) }; }
+	inline Float8 operator-(Float8 a) { return { _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)) }; }
+	inline Float8 operator<(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+	inline Float8 operator<=(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+	inline Float8 operator>(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+	inline Float8 operator>=(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+	inline Float8 operator&(Float8 a, Float8 b) { return { _mm256_and_ps(a.v, b.v) }; }
+	inline Float8 operator|(Float8 a, Float8 b) { return { _mm256_or_ps(a.v, b.v) }; }
+	inline Float8 select(Float8 mask, Float8 a, Float8 b) { return { _mm256_blendv_ps(b.v, a.v, mask.v) }; }
+	inline Float8 maskToFloat(Float8 mask) { return { _mm256_and_ps(mask.v, _mm256_set1_ps(1.0f)) }; }
+	inline Float8 min(Float8 a, Float8 b) { return { _mm256_min_ps(a.v, b.v) }; }
+	inline Float8 max(Float8 a, Float8 b) { return { _mm256_max_ps(a.v, b.v) }; }
+	inline Float8 sqrt(Float8 a) { return { _mm256_sqrt_ps(a.v) }; }
+	inline Float8 abs(Float8 a) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v) }; }
+	inline bool any(Float8 mask) { return _mm256_movemask_ps(mask.v) != 0; }
+	template<> inline Float8 load<Float8>(const float* p) { return { _mm256_loadu_ps(p) }; }
+	template<> inline Float8 splat<Float8>(float x) { return { _mm256_set1_ps(x) }; }
+	inline void store(float* p, Float8 v) { _mm256_storeu_ps(p, v.v); }
+#endif
+
+	// The widest lane type available.
+#if defined(PHYSICS_SIMD_AVX2)
+	using FloatN = Float8;
+#elif defined(PHYSICS_SIMD_SSE2)
+	using FloatN = Float4;
+#else
+	using FloatN = float;
+#endif
+}
@@ -4,7 +4,7 @@
 void SystemManager::onEntityDestroyed(Entity entity) {
 	for (auto const& pair : mSystems) {
 		auto const& system = pair.second;
-		system->m_entities.erase(entity);
+		system->m_entitiesVersion += static_cast<uint32_t>(system->m_entities.erase(entity));
 	}
 }
 void SystemManager::onEntitySignatureChange(Entity entity, Signature signature) {
@@ -14,9 +14,9 @@ void SystemManager::onEntitySignatureChange(Entity entity, Signature signature)
 		auto const& systemSignature = mSignatures[type];
 
 		if ((signature & systemSignature) == systemSignature) {
-			system->m_entities.insert(entity);
+			system->m_entitiesVersion += system->m_entities.insert(entity).second;
 		} else {
-			system->m_entities.erase(entity);
+			system->m_entitiesVersion += static_cast<uint32_t>(system->m_entities.erase(entity));
 		}
 	}
 }
\ No newline at end of file
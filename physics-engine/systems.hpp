@@ -15,6 +15,9 @@ public:
 public:
 	virtual void update(float deltaTime) = 0;
 	std::set<Entity> m_entities;
+	// Goes up whenever an entity joins or leaves m_entities, so that a system keeping state per
+	// entity can tell without walking them.
+	uint32_t m_entitiesVersion = 0;
 	Coordinator& m_coordinator;
 };
 
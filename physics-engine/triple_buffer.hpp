@@ -0,0 +1,39 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest value from one writer thread to one reader thread without either waiting.
+// The writer fills the back slot and swaps it with the middle one, the reader swaps its front
+// slot with the middle one if that holds something newer. Neither ever touches the other's slot,
+// and the reader always sees the last value published, skipping any it was too slow for.
+template<class T>
+class TripleBuffer {
+public:
+	// Writer only. The slot to fill, it may still hold an older value.
+	T& back() {
+		return m_slots[m_back];
+	}
+
+	// Writer only. Makes the back slot the latest value.
+	void publish() {
+		m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	// Reader only. The latest value published, or the one returned last time if nothing new was.
+	const T& acquire() {
+		if (m_middle.load(std::memory_order_relaxed) & FRESH) {
+			m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+		}
+		return m_slots[m_front];
+	}
+private:
+	// The middle slot's index, with FRESH set while it holds a value the reader has not taken.
+	static constexpr uint8_t INDEX = 0x3;
+	static constexpr uint8_t FRESH = 0x4;
+
+	std::array<T, 3> m_slots{};
+	uint8_t m_back = 0;
+	alignas(64) std::atomic<uint8_t> m_middle{ 1 };
+	alignas(64) uint8_t m_front = 2;
+};
@@ -25,8 +25,13 @@ using Entity = uint32_t;
 // Represents a particular component. Expands to uint8_t.
 using ComponentType = uint8_t;
 
-// The maximum entities for the program. Determined at compile-time.
+// The maximum entities for the program. Determined at compile-time, a build can raise it by
+// defining PHYSICS_MAX_ENTITIES (e.g. the benchmark, for scenarios of a million bodies).
+#ifdef PHYSICS_MAX_ENTITIES
+constexpr Entity MAX_ENTITIES = PHYSICS_MAX_ENTITIES;
+#else
 constexpr Entity MAX_ENTITIES = 10000;
+#endif
 
 // The maximum number of components for the program. Determined at compile-time.
 constexpr ComponentType MAX_COMPONENTS = 32;